@@ -146,11 +146,46 @@ unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout);
 unsigned long pulseInLong(uint8_t pin, uint8_t state, unsigned long timeout);
 
 void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
+void shiftOutBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buf, size_t len);
 uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
 
 void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode);
 void detachInterrupt(uint8_t interruptNum);
 
+// SRAM usage: free bytes between heap and stack now and at the lowest
+// point so far, the deepest the stack has been, and the end of the heap
+size_t sramFree(void);
+size_t sramFreeMin(void);
+size_t sramStackHighWater(void);
+void *sramHeapTop(void);
+// calls handler once when the stack has come within margin bytes of the
+// heap, from the timer 0 interrupt or after loop() returns; NULL switches
+// the check off
+void setSramFaultHandler(void (*handler)(void), size_t margin);
+
+// Call from loop() when there is nothing left to do until the next
+// interrupt: once loop() and serialEvent() have returned, the core sleeps
+// in the deepest mode the peripherals and interrupts in use allow, and
+// millis() keeps counting through it. setIdleSleepMode() limits that
+// mode, e.g. to SLEEP_MODE_IDLE to keep the I/O clock running.
+void loopIdle(void);
+void setIdleSleepMode(uint8_t deepest);
+
+// Work deferred from interrupt handlers. postEvent() queues a call of
+// handler(arg) and returns false if the queue (EVENT_QUEUE_SIZE, 16 by
+// default) is full. Queued calls run in order after loop() returns and
+// from yield(), e.g. while waiting in delay(); runEvents() runs them
+// right away and returns how many it ran. eventsDropped() returns (and
+// resets) how many posts failed.
+typedef void (*eventFuncPtr)(uint16_t arg);
+bool postEvent(eventFuncPtr handler, uint16_t arg);
+uint8_t runEvents(void);
+uint8_t eventsDropped(void);
+// Like attachInterrupt(), but handler(count) runs from the event queue
+// instead of the interrupt, count being the number of triggers since it
+// last ran. A pin that triggers again before then takes no extra slot.
+void attachInterruptDeferred(uint8_t interruptNum, eventFuncPtr handler, int mode);
+
 void setup(void);
 void loop(void);
 
@@ -244,9 +279,27 @@ uint16_t makeWord(byte h, byte l);
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
 unsigned long pulseInLong(uint8_t pin, uint8_t state, unsigned long timeout = 1000000L);
 
+// Shifts out len bytes from buf, as repeated shiftOut() calls would.
+inline void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const void *buf, size_t len)
+  { shiftOutBuffer(dataPin, clockPin, bitOrder, (const uint8_t *)buf, len); }
+
 void tone(uint8_t _pin, unsigned int frequency, unsigned long duration = 0);
 void noTone(uint8_t _pin);
 
+// Polyphonic tone generator on timer 2 (see PolyTone.cpp). Voices are
+// mixed into one PWM output and notes can be queued to play in the
+// background. A duration of 0 plays until stopped, a frequency of 0 rests.
+#if defined(TCCR2A) && defined(TCCR2B) && defined(OCR2A) && defined(OCR2B) && \
+    defined(TIMSK2) && defined(WGM22)
+void polyToneBegin();
+void polyToneEnd();
+void polyTone(uint8_t voice, unsigned int frequency, unsigned long duration = 0);
+bool polyToneQueue(uint8_t voice, unsigned int frequency, unsigned int duration);
+void polyNoTone(uint8_t voice);
+uint8_t polyToneQueued(uint8_t voice);
+bool polyTonePlaying();
+#endif
+
 // WMath prototypes
 long random(long);
 long random(long, long);
@@ -210,6 +210,21 @@ int Serial_::read(void)
 	return USB_Recv(CDC_RX);
 }
 
+int Serial_::read(uint8_t *buffer, size_t length)
+{
+	size_t count = 0;
+	if (length && peek_buffer >= 0) {
+		buffer[count++] = peek_buffer;
+		peek_buffer = -1;
+	}
+	// USB_Recv() takes an int and only reads what is in the endpoint FIFO
+	if (count < length) {
+		int n = USB_Recv(CDC_RX, buffer + count, length - count > 0x7fff ? 0x7fff : length - count);
+		if (n > 0) count += n;
+	}
+	return count;
+}
+
 int Serial_::availableForWrite(void)
 {
 	return USB_SendSpace(CDC_TX);
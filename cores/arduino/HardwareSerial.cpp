@@ -44,21 +44,25 @@
 #if defined(HAVE_HWSERIAL0)
   void serialEvent() __attribute__((weak));
   bool Serial0_available() __attribute__((weak));
+  bool Serial0_txPending() __attribute__((weak));
 #endif
 
 #if defined(HAVE_HWSERIAL1)
   void serialEvent1() __attribute__((weak));
   bool Serial1_available() __attribute__((weak));
+  bool Serial1_txPending() __attribute__((weak));
 #endif
 
 #if defined(HAVE_HWSERIAL2)
   void serialEvent2() __attribute__((weak));
   bool Serial2_available() __attribute__((weak));
+  bool Serial2_txPending() __attribute__((weak));
 #endif
 
 #if defined(HAVE_HWSERIAL3)
   void serialEvent3() __attribute__((weak));
   bool Serial3_available() __attribute__((weak));
+  bool Serial3_txPending() __attribute__((weak));
 #endif
 
 void serialEventRun(void)
@@ -77,6 +81,25 @@ void serialEventRun(void)
 #endif
 }
 
+// Used by the idle sleep in wiring_sleep.c, which must not power down
+// while a port is still sending.
+extern "C" bool serialTxPending(void)
+{
+#if defined(HAVE_HWSERIAL0)
+  if (Serial0_txPending && Serial0_txPending()) return true;
+#endif
+#if defined(HAVE_HWSERIAL1)
+  if (Serial1_txPending && Serial1_txPending()) return true;
+#endif
+#if defined(HAVE_HWSERIAL2)
+  if (Serial2_txPending && Serial2_txPending()) return true;
+#endif
+#if defined(HAVE_HWSERIAL3)
+  if (Serial3_txPending && Serial3_txPending()) return true;
+#endif
+  return false;
+}
+
 // macro to guard critical sections when needed for large TX buffer sizes
 #if (SERIAL_TX_BUFFER_SIZE>256)
 #define TX_BUFFER_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
@@ -189,6 +212,24 @@ int HardwareSerial::read(void)
   }
 }
 
+int HardwareSerial::read(uint8_t *buffer, size_t length)
+{
+  rx_buffer_index_t head = _rx_buffer_head;
+  rx_buffer_index_t tail = _rx_buffer_tail;
+  size_t count = 0;
+  // Copy up to the head, in two runs if the data wraps around the end
+  // of the buffer
+  while (count < length && tail != head) {
+    size_t n = (head > tail ? head : SERIAL_RX_BUFFER_SIZE) - tail;
+    if (n > length - count) n = length - count;
+    memcpy(buffer + count, _rx_buffer + tail, n);
+    count += n;
+    tail = (rx_buffer_index_t)(tail + n) % SERIAL_RX_BUFFER_SIZE;
+  }
+  _rx_buffer_tail = tail;
+  return count;
+}
+
 int HardwareSerial::availableForWrite(void)
 {
   tx_buffer_index_t head;
@@ -202,6 +243,12 @@ int HardwareSerial::availableForWrite(void)
   return tail - head - 1;
 }
 
+bool HardwareSerial::txPending()
+{
+  // as in flush(), TXC cannot be trusted before the first write
+  return _written && (bit_is_set(*_ucsrb, UDRIE0) || bit_is_clear(*_ucsra, TXC0));
+}
+
 void HardwareSerial::flush()
 {
   // If we have never written a byte, no need to flush. This special
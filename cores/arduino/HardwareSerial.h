@@ -124,8 +124,12 @@ class HardwareSerial : public Stream
     virtual int available(void);
     virtual int peek(void);
     virtual int read(void);
+    virtual int read(uint8_t *buffer, size_t length);
     virtual int availableForWrite(void);
     virtual void flush(void);
+    // true while written data is still being sent, i.e. until flush()
+    // would return
+    bool txPending(void);
     virtual size_t write(uint8_t);
     inline size_t write(unsigned long n) { return write((uint8_t)n); }
     inline size_t write(long n) { return write((uint8_t)n); }
@@ -76,4 +76,8 @@ bool Serial0_available() {
   return Serial.available();
 }
 
+bool Serial0_txPending() {
+  return Serial.txPending();
+}
+
 #endif // HAVE_HWSERIAL0
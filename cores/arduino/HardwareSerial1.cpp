@@ -66,4 +66,8 @@ bool Serial1_available() {
   return Serial1.available();
 }
 
+bool Serial1_txPending() {
+  return Serial1.txPending();
+}
+
 #endif // HAVE_HWSERIAL1
@@ -54,4 +54,8 @@ bool Serial2_available() {
   return Serial2.available();
 }
 
+bool Serial2_txPending() {
+  return Serial2.txPending();
+}
+
 #endif // HAVE_HWSERIAL2
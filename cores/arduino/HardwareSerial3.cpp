@@ -54,4 +54,8 @@ bool Serial3_available() {
   return Serial3.available();
 }
 
+bool Serial3_txPending() {
+  return Serial3.txPending();
+}
+
 #endif // HAVE_HWSERIAL3
@@ -0,0 +1,155 @@
+/*
+  NumberParser.cpp - Incremental parser for decimal numbers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <limits.h>
+#include <math.h>
+#include "NumberParser.h"
+
+// A float has 24 bits of mantissa, so further digits only move the
+// decimal point. Stopping here keeps _mantissa * 10 within 32 bits.
+#define MAX_FLOAT_MANTISSA 100000000UL
+
+// Exponents beyond this are infinite or zero for any float
+#define MAX_EXPONENT 999
+
+void NumberParser::begin(bool fraction, char ignore)
+{
+  _mantissa = 0;
+  _scale = 0;
+  _exponent = 0;
+  _flags = fraction ? FRACTION : 0;
+  _ignore = ignore;
+}
+
+bool NumberParser::feed(char c)
+{
+  if ((_flags & STARTED) && c == _ignore)
+    return true;
+
+  if (c >= '0' && c <= '9') {
+    uint8_t d = c - '0';
+    _flags |= STARTED;
+    if (_flags & EXPONENT) {
+      if (_exponent < MAX_EXPONENT)
+        _exponent = _exponent * 10 + d;
+      _flags |= EXP_DIGITS;
+    } else if (_flags & FRACTION) {
+      _flags |= DIGITS;
+      // _scale is held within +-MAX_EXPONENT, past which the result is
+      // infinite or zero anyway
+      if (_mantissa < MAX_FLOAT_MANTISSA) {
+        _mantissa = _mantissa * 10 + d;
+        if ((_flags & POINT) && _scale > -MAX_EXPONENT)
+          _scale--;
+      } else if (!(_flags & POINT) && _scale < MAX_EXPONENT) {
+        _scale++;
+      }
+    } else {
+      _flags |= DIGITS;
+      if (_mantissa > (0xFFFFFFFFUL - d) / 10)
+        _flags |= TOO_BIG;
+      else
+        _mantissa = _mantissa * 10 + d;
+    }
+    return true;
+  }
+
+  if (!(_flags & STARTED)) {
+    if (c == '-') {
+      _flags |= STARTED | NEGATIVE;
+      return true;
+    }
+  }
+
+  if (!(_flags & FRACTION))
+    return false;
+
+  if (c == '.' && !(_flags & (POINT | EXPONENT))) {
+    _flags |= STARTED | POINT;
+    return true;
+  }
+  if ((c == 'e' || c == 'E') && (_flags & DIGITS) && !(_flags & EXPONENT)) {
+    _flags |= EXPONENT;
+    return true;
+  }
+  if ((c == '-' || c == '+') && (_flags & EXPONENT) && !(_flags & (EXP_SIGN | EXP_DIGITS))) {
+    _flags |= EXP_SIGN;
+    if (c == '-')
+      _flags |= EXP_NEG;
+    return true;
+  }
+  return false;
+}
+
+bool NumberParser::overflow() const
+{
+  if (!(_flags & FRACTION)) {
+    if (_flags & TOO_BIG)
+      return true;
+    return _mantissa > ((_flags & NEGATIVE) ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX);
+  }
+  float value = toFloat();
+  return isinf(value) || (value == 0 && _mantissa != 0);
+}
+
+long NumberParser::toLong() const
+{
+  if (_flags & FRACTION) {
+    // converting a float outside the range of long is undefined
+    float value = toFloat();
+    if (value >= 2147483648.0f)
+      return LONG_MAX;
+    if (value <= -2147483648.0f)
+      return LONG_MIN;
+    return (long)value;
+  }
+  if (overflow())
+    return (_flags & NEGATIVE) ? LONG_MIN : LONG_MAX;
+  if (_flags & NEGATIVE)
+    return _mantissa > LONG_MAX ? LONG_MIN : -(long)_mantissa;
+  return _mantissa;
+}
+
+float NumberParser::toFloat() const
+{
+  if (!(_flags & FRACTION))
+    return toLong();
+
+  float value = _mantissa;
+  int16_t e = _scale + ((_flags & EXP_NEG) ? -_exponent : _exponent);
+  if (value != 0 && e != 0) {
+    // Scale down in two steps if needed, so that the power of ten below
+    // stays finite for results close to the smallest float
+    if (e < -30) {
+      value *= 1e-30;
+      e += 30;
+    }
+    // 10^|e| by squaring, then one multiply or divide
+    uint16_t n = e < 0 ? -e : e;
+    float power = 1;
+    float square = 10;
+    while (n) {
+      if (n & 1)
+        power *= square;
+      square *= square;
+      n >>= 1;
+    }
+    value = e < 0 ? value / power : value * power;
+  }
+  return (_flags & NEGATIVE) ? -value : value;
+}
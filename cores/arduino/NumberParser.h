@@ -0,0 +1,76 @@
+/*
+  NumberParser.h - Incremental parser for decimal numbers
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef NumberParser_h
+#define NumberParser_h
+
+#include <inttypes.h>
+
+#define NO_IGNORE_CHAR  '\x01' // a char not found in a valid ASCII numeric field
+
+// Builds a number from characters fed one at a time, as used by
+// Stream::parseInt() and parseFloat(). Digits are collected in a 32-bit
+// integer and the decimal point and exponent are kept as a power of ten,
+// so a float is produced with a single scaling step at the end instead
+// of a float operation per digit.
+//
+// Accepted is an optional leading '-', digits and, for floats, one '.'
+// and an exponent ('e' or 'E', optional sign, digits). The ignore
+// character is skipped anywhere after the first character.
+class NumberParser
+{
+  public:
+    NumberParser(bool fraction = false, char ignore = NO_IGNORE_CHAR) { begin(fraction, ignore); }
+    void begin(bool fraction = false, char ignore = NO_IGNORE_CHAR);
+
+    // feeds the next character; returns false if it cannot continue the
+    // number, in which case it is not part of it
+    bool feed(char c);
+
+    bool acceptsFraction() const { return _flags & FRACTION; }
+    // true once at least one digit has been seen
+    bool hasDigits() const { return _flags & DIGITS; }
+    // true if the value did not fit: toLong() then returns LONG_MAX or
+    // LONG_MIN, toFloat() returns infinity (or 0 if it was too small)
+    bool overflow() const;
+
+    long toLong() const;
+    float toFloat() const;
+
+  private:
+    enum {
+      FRACTION = 0x01,  // '.' and exponents are accepted
+      NEGATIVE = 0x02,
+      DIGITS   = 0x04,  // mantissa digits seen
+      POINT    = 0x08,  // '.' seen
+      EXPONENT = 0x10,  // 'e' seen
+      EXP_SIGN = 0x20,
+      EXP_NEG  = 0x40,
+      EXP_DIGITS = 0x80,
+      TOO_BIG  = 0x100, // integer overflow
+      STARTED  = 0x200  // anything but an ignored character seen
+    };
+
+    uint32_t _mantissa;
+    int16_t _scale;     // power of ten from dropped digits and the '.'
+    int16_t _exponent;  // the explicit exponent
+    uint16_t _flags;
+    char _ignore;
+};
+
+#endif
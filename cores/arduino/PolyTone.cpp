@@ -0,0 +1,277 @@
+/*
+  PolyTone.cpp - Polyphonic, non-blocking tone generator
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// Unlike tone(), which dedicates a timer to every pin and toggles it from
+// a compare interrupt, this mixes POLYTONE_VOICES square waves into a single
+// PWM output. Timer 2 runs in fast PWM mode with OCR2A as TOP, so its
+// overflow interrupt fires at POLYTONE_SAMPLE_RATE. Every overflow advances
+// one 16-bit phase accumulator per voice (direct digital synthesis) and
+// writes the sum of the voices that are in their high half-period to OCR2B,
+// which drives the OC2B pin (pin 3 on the Uno, pin 9 on the Mega).
+//
+// Each voice also has a small queue of (frequency, duration) notes, so a
+// whole melody or alert pattern can be queued from setup() or loop() and
+// plays from the interrupt without blocking. The interrupt is switched off
+// whenever all voices are silent.
+//
+// This takes over timer 2, so tone() and analogWrite() on the timer 2 pins
+// cannot be used between polyToneBegin() and polyToneEnd().
+
+#include <avr/interrupt.h>
+#include "Arduino.h"
+#include "wiring_private.h"
+
+#if defined(TCCR2A) && defined(TCCR2B) && defined(OCR2A) && defined(OCR2B) && \
+    defined(TIMSK2) && defined(WGM22)
+
+// Number of voices that are mixed together
+#if !defined(POLYTONE_VOICES)
+#define POLYTONE_VOICES 4
+#endif
+
+// Number of notes that can be queued per voice, not counting the one
+// that is playing
+#if !defined(POLYTONE_QUEUE_SIZE)
+#define POLYTONE_QUEUE_SIZE 4
+#endif
+
+// Samples (and PWM periods) per second. Frequencies up to half of this
+// can be played.
+#if !defined(POLYTONE_SAMPLE_RATE)
+#define POLYTONE_SAMPLE_RATE 15625L
+#endif
+
+// Timer 2 runs at F_CPU / 8
+#define POLYTONE_TOP (F_CPU / 8 / POLYTONE_SAMPLE_RATE - 1)
+#if POLYTONE_TOP > 255 || POLYTONE_TOP < POLYTONE_VOICES
+#error "POLYTONE_SAMPLE_RATE does not fit timer 2 at this F_CPU"
+#endif
+
+// PWM level added for every voice that is high. When all voices are high
+// the output is held high for the whole period.
+#define POLYTONE_STEP ((POLYTONE_TOP + 1) / POLYTONE_VOICES)
+
+struct PolyToneNote {
+  uint16_t increment;  // phase increment per sample, 0 for a rest
+  uint16_t duration;   // in milliseconds, 0 means until stopped
+};
+
+struct PolyToneVoice {
+  uint16_t phase;
+  uint16_t increment;
+  uint16_t remaining;  // milliseconds left of the current note
+  bool playing;        // false when the voice is idle
+  uint8_t head;        // next note to play
+  uint8_t count;       // number of queued notes
+  PolyToneNote queue[POLYTONE_QUEUE_SIZE];
+};
+
+static PolyToneVoice voices[POLYTONE_VOICES];
+static uint16_t ms_fract;
+static uint8_t poly_pin = NOT_A_PIN;
+
+static uint16_t frequencyToIncrement(unsigned int frequency)
+{
+  if (frequency >= POLYTONE_SAMPLE_RATE / 2)
+    frequency = POLYTONE_SAMPLE_RATE / 2 - 1;
+  return ((uint32_t)frequency << 16) / POLYTONE_SAMPLE_RATE;
+}
+
+// Starts the next queued note on a voice, or silences it.
+// Called with interrupts disabled.
+static void nextNote(PolyToneVoice *v)
+{
+  if (v->count) {
+    PolyToneNote *n = &v->queue[v->head];
+    v->increment = n->increment;
+    v->remaining = n->duration;
+    v->playing = true;
+    v->head = (v->head + 1) % POLYTONE_QUEUE_SIZE;
+    v->count--;
+  } else {
+    v->increment = 0;
+    v->remaining = 0;
+    v->playing = false;
+  }
+  if (!v->increment)
+    v->phase = 0;
+}
+
+static void startOutput()
+{
+  if (poly_pin != NOT_A_PIN)
+    sbi(TIMSK2, TOIE2);
+}
+
+ISR(TIMER2_OVF_vect)
+{
+  // With all voices high the sum can reach TOP + 1, which is 256 when
+  // TOP is 255, so add up in 16 bits and hold it at TOP.
+  uint16_t level = 0;
+  for (uint8_t i = 0; i < POLYTONE_VOICES; i++) {
+    PolyToneVoice *v = &voices[i];
+    v->phase += v->increment;
+    if (v->phase & 0x8000)
+      level += POLYTONE_STEP;
+  }
+  OCR2B = level > POLYTONE_TOP ? POLYTONE_TOP : level;
+
+  // Count whole milliseconds of samples for the note durations
+  ms_fract += 1000;
+  if (ms_fract < POLYTONE_SAMPLE_RATE)
+    return;
+  ms_fract -= POLYTONE_SAMPLE_RATE;
+
+  bool busy = false;
+  for (uint8_t i = 0; i < POLYTONE_VOICES; i++) {
+    PolyToneVoice *v = &voices[i];
+    if (v->remaining && --v->remaining == 0)
+      nextNote(v);
+    busy |= v->playing;
+  }
+
+  if (!busy) {
+    // Nothing left to play, stop interrupting until a new note arrives.
+    // OCR2B is double buffered, so the last period still ends low.
+    OCR2B = 0;
+    cbi(TIMSK2, TOIE2);
+  }
+}
+
+void polyToneBegin()
+{
+  // Find the pin driven by OC2B on this board
+  uint8_t pin;
+  for (pin = 0; pin < NUM_DIGITAL_PINS; pin++) {
+    if (digitalPinToTimer(pin) == TIMER2B)
+      break;
+  }
+  if (pin == NUM_DIGITAL_PINS)
+    return;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  memset(voices, 0, sizeof(voices));
+  ms_fract = 0;
+
+  // Fast PWM with OCR2A as TOP (mode 7), non-inverting output on OC2B,
+  // clocked at F_CPU / 8
+  TIMSK2 = 0;
+  TCCR2A = _BV(COM2B1) | _BV(WGM21) | _BV(WGM20);
+  TCCR2B = _BV(WGM22) | _BV(CS21);
+  OCR2A = POLYTONE_TOP;
+  OCR2B = 0;
+  TCNT2 = 0;
+  poly_pin = pin;
+  SREG = oldSREG;
+
+  pinMode(pin, OUTPUT);
+}
+
+void polyToneEnd()
+{
+  if (poly_pin == NOT_A_PIN)
+    return;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  // Put timer 2 back the way init() left it: phase correct PWM, clk/64
+  TIMSK2 = 0;
+  TCCR2A = _BV(WGM20);
+  TCCR2B = _BV(CS22);
+  OCR2A = 0;
+  OCR2B = 0;
+  SREG = oldSREG;
+
+  digitalWrite(poly_pin, LOW);
+  poly_pin = NOT_A_PIN;
+}
+
+void polyTone(uint8_t voice, unsigned int frequency, unsigned long duration)
+{
+  if (voice >= POLYTONE_VOICES)
+    return;
+  if (duration > 0xffff)
+    duration = 0xffff;
+
+  PolyToneVoice *v = &voices[voice];
+  uint8_t oldSREG = SREG;
+  cli();
+  v->count = 0;
+  v->increment = frequencyToIncrement(frequency);
+  v->remaining = duration;
+  v->playing = true;
+  if (!v->increment)
+    v->phase = 0;
+  startOutput();
+  SREG = oldSREG;
+}
+
+bool polyToneQueue(uint8_t voice, unsigned int frequency, unsigned int duration)
+{
+  if (voice >= POLYTONE_VOICES)
+    return false;
+
+  PolyToneVoice *v = &voices[voice];
+  bool queued = true;
+  uint8_t oldSREG = SREG;
+  cli();
+  if (v->count == POLYTONE_QUEUE_SIZE) {
+    queued = false;
+  } else {
+    PolyToneNote *n = &v->queue[(v->head + v->count) % POLYTONE_QUEUE_SIZE];
+    n->increment = frequencyToIncrement(frequency);
+    n->duration = duration;
+    v->count++;
+    if (!v->playing)
+      nextNote(v);
+    startOutput();
+  }
+  SREG = oldSREG;
+  return queued;
+}
+
+void polyNoTone(uint8_t voice)
+{
+  if (voice >= POLYTONE_VOICES)
+    return;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  voices[voice].count = 0;
+  nextNote(&voices[voice]);
+  SREG = oldSREG;
+}
+
+uint8_t polyToneQueued(uint8_t voice)
+{
+  if (voice >= POLYTONE_VOICES)
+    return 0;
+  return voices[voice].count;
+}
+
+bool polyTonePlaying()
+{
+  for (uint8_t i = 0; i < POLYTONE_VOICES; i++) {
+    if (voices[i].playing)
+      return true;
+  }
+  return false;
+}
+
+#endif
@@ -0,0 +1,136 @@
+/*
+  PoolAllocator.cpp - Optional fixed-block allocator for new and String
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "PoolAllocator.h"
+
+#if defined(POOL_ALLOCATOR_SIZE) && POOL_ALLOCATOR_SIZE > 0
+
+// Block sizes are 8 << n for n < POOL_CLASSES. The first byte of every
+// block holds n; a free block keeps the pointer to the next free block
+// of its size right after that.
+#define POOL_CLASSES 5
+#define POOL_BLOCK_SIZE(n) ((size_t)8 << (n))
+
+static uint8_t arena[POOL_ALLOCATOR_SIZE];
+static uint8_t *arenaTop = arena;  // start of the part never handed out
+static uint8_t *freeLists[POOL_CLASSES];
+
+static size_t used;
+static size_t highWater;
+static size_t cached;
+static unsigned long fallbacks;
+
+static inline bool inPool(void *ptr)
+{
+  return (uint8_t *)ptr >= arena && (uint8_t *)ptr < arena + POOL_ALLOCATOR_SIZE;
+}
+
+void *poolMalloc(size_t size)
+{
+  // the header byte counts against the block size
+  uint8_t n = 0;
+  while (n < POOL_CLASSES && size >= POOL_BLOCK_SIZE(n))
+    n++;
+
+  if (n < POOL_CLASSES) {
+    size_t blockSize = POOL_BLOCK_SIZE(n);
+    uint8_t oldSREG = SREG;
+    cli();
+    uint8_t *block = freeLists[n];
+    if (block) {
+      memcpy(&freeLists[n], block + 1, sizeof(block));
+      cached -= blockSize;
+    } else if ((size_t)(arena + POOL_ALLOCATOR_SIZE - arenaTop) >= blockSize) {
+      block = arenaTop;
+      arenaTop += blockSize;
+    }
+    if (block) {
+      block[0] = n;
+      used += blockSize;
+      if (used > highWater)
+        highWater = used;
+      SREG = oldSREG;
+      return block + 1;
+    }
+    SREG = oldSREG;
+  }
+
+  uint8_t oldSREG = SREG;
+  cli();
+  fallbacks++;
+  SREG = oldSREG;
+  return malloc(size);
+}
+
+void poolFree(void *ptr)
+{
+  if (!inPool(ptr)) {
+    free(ptr);
+    return;
+  }
+  uint8_t *block = (uint8_t *)ptr - 1;
+  uint8_t n = block[0];
+  uint8_t oldSREG = SREG;
+  cli();
+  memcpy(block + 1, &freeLists[n], sizeof(block));
+  freeLists[n] = block;
+  used -= POOL_BLOCK_SIZE(n);
+  cached += POOL_BLOCK_SIZE(n);
+  SREG = oldSREG;
+}
+
+void *poolRealloc(void *ptr, size_t size)
+{
+  if (!ptr)
+    return poolMalloc(size);
+  if (!inPool(ptr))
+    return realloc(ptr, size);
+
+  // keep the block if the new size still fits in it
+  size_t available = POOL_BLOCK_SIZE(((uint8_t *)ptr)[-1]) - 1;
+  if (size <= available)
+    return ptr;
+
+  void *moved = poolMalloc(size);
+  if (!moved)
+    return NULL;
+  memcpy(moved, ptr, available);
+  poolFree(ptr);
+  return moved;
+}
+
+bool getPoolStats(PoolStats *stats)
+{
+  stats->arenaSize = POOL_ALLOCATOR_SIZE;
+  uint8_t oldSREG = SREG;
+  cli();
+  stats->used = used;
+  stats->highWater = highWater;
+  stats->cached = cached;
+  stats->untouched = arena + POOL_ALLOCATOR_SIZE - arenaTop;
+  stats->fallbacks = fallbacks;
+  SREG = oldSREG;
+  size_t available = stats->cached + stats->untouched;
+  stats->fragmentation = available ? (uint32_t)stats->cached * 100 / available : 0;
+  return true;
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+  PoolAllocator.h - Optional fixed-block allocator for new and String
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef PoolAllocator_h
+#define PoolAllocator_h
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+// operator new, new[] and String allocate through poolMalloc(),
+// poolFree() and poolRealloc(). By default these are just malloc(),
+// free() and realloc().
+//
+// Defining POOL_ALLOCATOR_SIZE (e.g. -DPOOL_ALLOCATOR_SIZE=512 in the
+// build flags, for every file of the core) reserves a static arena of
+// that many bytes instead. Small requests are served from it in blocks of
+// 8, 16, 32, 64 or 128 bytes (including a one byte header), and freed
+// blocks are kept in a free list per size, so both allocating and freeing
+// take constant time and the churn of short Strings cannot fragment the
+// malloc heap. Larger requests, and requests for a size whose free list
+// is empty once the arena is used up, fall back to malloc().
+//
+// The free lists and counters are only changed with interrupts disabled,
+// so blocks from the arena can be allocated and freed in an interrupt.
+// Requests that fall back to malloc() are no safer there than malloc().
+
+struct PoolStats {
+  size_t arenaSize;        // POOL_ALLOCATOR_SIZE
+  size_t used;             // bytes in blocks handed out right now
+  size_t highWater;        // the most bytes ever handed out at once
+  size_t cached;           // bytes in freed blocks, kept for reuse
+  size_t untouched;        // bytes of the arena never handed out
+  uint8_t fragmentation;   // cached as a percentage of cached + untouched
+  unsigned long fallbacks; // requests passed on to malloc()
+};
+
+#if defined(POOL_ALLOCATOR_SIZE) && POOL_ALLOCATOR_SIZE > 0
+
+void *poolMalloc(size_t size);
+void poolFree(void *ptr);
+void *poolRealloc(void *ptr, size_t size);
+// fills stats and returns true
+bool getPoolStats(PoolStats *stats);
+
+#else
+
+inline void *poolMalloc(size_t size) { return malloc(size); }
+inline void poolFree(void *ptr) { free(ptr); }
+inline void *poolRealloc(void *ptr, size_t size) { return realloc(ptr, size); }
+// returns false, there is no pool
+inline bool getPoolStats(PoolStats *stats) { (void)stats; return false; }
+
+#endif
+
+#endif
@@ -59,6 +59,18 @@ size_t Print::print(const String &s)
   return write(s.c_str(), s.length());
 }
 
+size_t Print::print(const StringView &s)
+{
+  if (!s.isFlash()) return write(s.data(), s.length());
+  PGM_P p = s.data();
+  size_t n = 0;
+  for (unsigned int i = 0; i < s.length(); i++) {
+    if (write(pgm_read_byte(p++))) n++;
+    else break;
+  }
+  return n;
+}
+
 size_t Print::print(const char str[])
 {
   return write(str);
@@ -135,6 +147,13 @@ size_t Print::println(const String &s)
   return n;
 }
 
+size_t Print::println(const StringView &s)
+{
+  size_t n = print(s);
+  n += println();
+  return n;
+}
+
 size_t Print::println(const char c[])
 {
   size_t n = print(c);
@@ -198,26 +217,204 @@ size_t Print::println(const Printable& x)
   return n;
 }
 
+// Collects the characters produced by vfprintf() and hands them to
+// write() in chunks, so buffered streams get bulk writes instead of
+// one virtual call per character.
+#if !defined(PRINTF_BUFFER_SIZE)
+#define PRINTF_BUFFER_SIZE 16
+#endif
+
+struct PrintfSink {
+  Print *print;
+  size_t count;
+  uint8_t len;
+  char buf[PRINTF_BUFFER_SIZE];
+};
+
+static bool printf_flush(PrintfSink *sink)
+{
+  size_t n = sink->print->write(sink->buf, sink->len);
+  sink->count += n;
+  bool ok = n == sink->len;
+  sink->len = 0;
+  return ok;
+}
+
+static int printf_putchar(char c, FILE *stream)
+{
+  PrintfSink *sink = (PrintfSink *)fdev_get_udata(stream);
+  sink->buf[sink->len++] = c;
+  if (sink->len == sizeof(sink->buf) && !printf_flush(sink))
+    return EOF; // makes vfprintf() stop
+  return 0;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  size_t n = vprintf(format, ap);
+  va_end(ap);
+  return n;
+}
+
+size_t Print::printf_P(PGM_P format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  size_t n = vprintf_P(format, ap);
+  va_end(ap);
+  return n;
+}
+
+size_t Print::printf(const __FlashStringHelper *format, ...)
+{
+  va_list ap;
+  va_start(ap, format);
+  size_t n = vprintf_P(reinterpret_cast<PGM_P>(format), ap);
+  va_end(ap);
+  return n;
+}
+
+size_t Print::vprintf(const char *format, va_list ap)
+{
+  FILE stream;
+  PrintfSink sink = { this, 0, 0 };
+  fdev_setup_stream(&stream, printf_putchar, NULL, _FDEV_SETUP_WRITE);
+  fdev_set_udata(&stream, &sink);
+  vfprintf(&stream, format, ap);
+  if (sink.len) printf_flush(&sink);
+  return sink.count;
+}
+
+size_t Print::vprintf_P(PGM_P format, va_list ap)
+{
+  FILE stream;
+  PrintfSink sink = { this, 0, 0 };
+  fdev_setup_stream(&stream, printf_putchar, NULL, _FDEV_SETUP_WRITE);
+  fdev_set_udata(&stream, &sink);
+  vfprintf_P(&stream, format, ap);
+  if (sink.len) printf_flush(&sink);
+  return sink.count;
+}
+
 // Private Methods /////////////////////////////////////////////////////////////
 
-size_t Print::printNumber(unsigned long n, uint8_t base)
+// Divides n by 10 without calling the 32-bit division routine, which costs
+// several hundred cycles per digit on AVR. The quotient is approximated as
+// n * 0.8 / 8 with shifts and adds and then corrected using the remainder
+// (Hacker's Delight, section 10-21).
+static inline unsigned long divmod10(unsigned long n, uint8_t *rem)
+{
+  unsigned long q = (n >> 1) + (n >> 2);
+  q += q >> 4;
+  q += q >> 8;
+  q += q >> 16;
+  q >>= 3;
+  uint8_t r = n - ((q << 3) + (q << 1));
+  if (r > 9) {
+    q++;
+    r -= 10;
+  }
+  *rem = r;
+  return q;
+}
+
+// Writes the digits of n in the given base so that they end just before
+// end, and returns a pointer to the first one.
+static char *formatNumber(unsigned long n, uint8_t base, char *end)
+{
+  char *str = end;
+
+  if (base == 10) {
+    uint8_t r;
+    // Peel off digits with 32-bit arithmetic only while needed...
+    while (n > 0xffff) {
+      n = divmod10(n, &r);
+      *--str = r + '0';
+    }
+    // ...then finish with a 16x16 multiply by the reciprocal of 10
+    // (0xcccd / 2^19), which is exact for every 16-bit value.
+    uint16_t m = n;
+    do {
+      uint16_t q = ((uint32_t)m * 0xcccd) >> 19;
+      *--str = (uint8_t)(m - q * 10) + '0';
+      m = q;
+    } while (m);
+  } else if ((base & (base - 1)) == 0) {
+    // Powers of two only need masks and shifts
+    uint8_t shift = 0;
+    while ((1 << shift) < base) shift++;
+    uint8_t mask = base - 1;
+    do {
+      char c = n & mask;
+      n >>= shift;
+      *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+  } else {
+    do {
+      char c = n % base;
+      n /= base;
+
+      *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while(n);
+  }
+
+  return str;
+}
+
+// Writes exactly count decimal digits of n (zero padded) ending before end
+static char *formatFraction(unsigned long n, uint8_t count, char *end)
 {
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
+  char *start = end - count;
+  char *str = formatNumber(n, 10, end);
+  while (str > start) *--str = '0';
+  return str;
+}
 
-  *str = '\0';
+// Powers of ten for scaling the fractional part of a float. 10^9 is the
+// largest one that fits in an unsigned long.
+#define FLOAT_MAX_SCALED_DIGITS 9
+static const unsigned long PROGMEM powersOf10[FLOAT_MAX_SCALED_DIGITS + 1] = {
+  1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL,
+  100000000UL, 1000000000UL
+};
+
+size_t Print::printNumber(unsigned long n, uint8_t base)
+{
+  char buf[8 * sizeof(long)]; // Assumes 8-bit chars, no terminator needed.
+  char *end = &buf[sizeof(buf)];
 
   // prevent crash if called with base == 1
   if (base < 2) base = 10;
 
-  do {
-    char c = n % base;
-    n /= base;
+  char *str = formatNumber(n, base, end);
+  return write(str, end - str);
+}
 
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while(n);
+// Prints "int_part.frac" with the given number of digits after the point.
+// frac holds the first scaled digits (at most FLOAT_MAX_SCALED_DIGITS) of
+// the fraction, the rest are padded with zeroes.
+size_t Print::printFixed(unsigned long int_part, unsigned long frac, uint8_t scaled, uint8_t digits)
+{
+  char buf[10 + 1 + FLOAT_MAX_SCALED_DIGITS];
+  char *end = &buf[sizeof(buf)];
+  char *str = end;
 
-  return write(str);
+  if (digits > 0) {
+    str = formatFraction(frac, scaled, str);
+    *--str = '.';
+  }
+  str = formatNumber(int_part, 10, str);
+
+  size_t n = write(str, end - str);
+
+  // A float has no more than 9 significant digits, so there is
+  // nothing but zeroes beyond this
+  for (; scaled < digits; scaled++)
+    n += print('0');
+
+  return n;
 }
 
 size_t Print::printFloat(double number, uint8_t digits) 
@@ -226,8 +423,11 @@ size_t Print::printFloat(double number, uint8_t digits)
   
   if (isnan(number)) return print("nan");
   if (isinf(number)) return print("inf");
-  if (number > 4294967040.0) return print ("ovf");  // constant determined empirically
-  if (number <-4294967040.0) return print ("ovf");  // constant determined empirically
+
+  // The integer part must fit an unsigned long; anything bigger is
+  // printed in scientific notation instead
+  if (number > 4294967040.0 || number < -4294967040.0)  // constant determined empirically
+    return printScientific(number, digits);
   
   // Handle negative numbers
   if (number < 0.0)
@@ -236,31 +436,76 @@ size_t Print::printFloat(double number, uint8_t digits)
      number = -number;
   }
 
-  // Round correctly so that print(1.999, 2) prints as "2.00"
-  double rounding = 0.5;
-  for (uint8_t i=0; i<digits; ++i)
-    rounding /= 10.0;
-  
-  number += rounding;
-
-  // Extract the integer part of the number and print it
+  // Scale the fraction once and round it as an integer, so that
+  // print(1.999, 2) prints as "2.00"
+  uint8_t scaled = digits > FLOAT_MAX_SCALED_DIGITS ? FLOAT_MAX_SCALED_DIGITS : digits;
+  unsigned long scale = pgm_read_dword(&powersOf10[scaled]);
   unsigned long int_part = (unsigned long)number;
-  double remainder = number - (double)int_part;
-  n += print(int_part);
-
-  // Print the decimal point, but only if there are digits beyond
-  if (digits > 0) {
-    n += print('.'); 
+  unsigned long frac = (number - (double)int_part) * scale + 0.5;
+  if (frac >= scale) {
+    frac -= scale;
+    int_part++;
   }
 
-  // Extract digits from the remainder one at a time
-  while (digits-- > 0)
+  return n + printFixed(int_part, frac, scaled, digits);
+}
+
+size_t Print::printScientific(double number, uint8_t digits)
+{
+  size_t n = 0;
+
+  if (isnan(number)) return print("nan");
+  if (isinf(number)) return print("inf");
+
+  if (number < 0.0)
   {
-    remainder *= 10.0;
-    unsigned int toPrint = (unsigned int)(remainder);
-    n += print(toPrint);
-    remainder -= toPrint; 
-  } 
-  
+     n += print('-');
+     number = -number;
+  }
+
+  // Bring the number into [1, 10) with at most six multiplications or
+  // divisions, which keeps the rounding error down compared to a loop
+  // dividing by 10 each time.
+  static const float PROGMEM scales[] = { 1e32, 1e16, 1e8, 1e4, 1e2, 1e1 };
+  static const uint8_t PROGMEM exponents[] = { 32, 16, 8, 4, 2, 1 };
+  int8_t exponent = 0;
+  if (number >= 10.0) {
+    for (uint8_t i = 0; i < sizeof(exponents); i++) {
+      float scale = pgm_read_float(&scales[i]);
+      if (number >= scale) {
+        number /= scale;
+        exponent += pgm_read_byte(&exponents[i]);
+      }
+    }
+  } else if (number < 1.0 && number > 0.0) {
+    for (uint8_t i = 0; i < sizeof(exponents); i++) {
+      float scale = pgm_read_float(&scales[i]);
+      if (number * scale < 10.0) {
+        number *= scale;
+        exponent -= pgm_read_byte(&exponents[i]);
+      }
+    }
+  }
+
+  // The mantissa is below 10, so one digit less than printFloat() can
+  // scale without overflowing
+  uint8_t scaled = digits > FLOAT_MAX_SCALED_DIGITS - 1 ? FLOAT_MAX_SCALED_DIGITS - 1 : digits;
+  unsigned long scale = pgm_read_dword(&powersOf10[scaled]);
+  unsigned long mantissa = number * scale + 0.5;
+  if (mantissa >= 10 * scale) {
+    // Rounded up to 10.0
+    mantissa /= 10;
+    exponent++;
+  }
+
+  n += printFixed(mantissa / scale, mantissa % scale, scaled, digits);
+  n += print('e');
+  if (exponent < 0) {
+    n += print('-');
+    exponent = -exponent;
+  } else {
+    n += print('+');
+  }
+  n += printNumber(exponent, 10);
   return n;
 }
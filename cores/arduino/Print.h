@@ -22,6 +22,7 @@
 
 #include <inttypes.h>
 #include <stdio.h> // for size_t
+#include <stdarg.h>
 
 #include "WString.h"
 #include "Printable.h"
@@ -40,6 +41,7 @@ class Print
     int write_error;
     size_t printNumber(unsigned long, uint8_t);
     size_t printFloat(double, uint8_t);
+    size_t printFixed(unsigned long, unsigned long, uint8_t, uint8_t);
   protected:
     void setWriteError(int err = 1) { write_error = err; }
   public:
@@ -64,6 +66,7 @@ class Print
 
     size_t print(const __FlashStringHelper *);
     size_t print(const String &);
+    size_t print(const StringView &);
     size_t print(const char[]);
     size_t print(char);
     size_t print(unsigned char, int = DEC);
@@ -74,8 +77,13 @@ class Print
     size_t print(double, int = 2);
     size_t print(const Printable&);
 
+    // Prints a number as "d.ddde+x". print(double) switches to this
+    // for values too large to print in plain notation.
+    size_t printScientific(double, uint8_t = 2);
+
     size_t println(const __FlashStringHelper *);
     size_t println(const String &s);
+    size_t println(const StringView &s);
     size_t println(const char[]);
     size_t println(char);
     size_t println(unsigned char, int = DEC);
@@ -87,6 +95,17 @@ class Print
     size_t println(const Printable&);
     size_t println(void);
 
+    // Formatted output through avr-libc's vfprintf(). The text is passed to
+    // write() in small chunks, without a heap or caller-provided buffer.
+    // Conversions follow the avr-libc printf family, so %f prints '?'
+    // unless the floating point version of vfprintf is linked in (and %s
+    // with printf_P still expects a RAM string; use %S for PROGMEM ones).
+    size_t printf(const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+    size_t printf_P(PGM_P format, ...);
+    size_t printf(const __FlashStringHelper *format, ...);
+    size_t vprintf(const char *format, va_list ap);
+    size_t vprintf_P(PGM_P format, va_list ap);
+
     virtual void flush() { /* Empty implementation for backward compatibility */ }
 };
 
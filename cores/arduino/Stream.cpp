@@ -27,10 +27,18 @@
 
 #define PARSE_TIMEOUT 1000  // default number of milli-seconds to wait
 
+// findMulti(targets, tCount) builds its matcher tables on the stack for at
+// most this many targets of this many characters together; larger sets
+// use the table-free search, or a StaticStreamMatcher from the caller
+#define FIND_MULTI_MAX_TARGETS 4
+#define FIND_MULTI_MAX_CHARS   32
+
 // protected method to read stream with timeout
 int Stream::timedRead()
 {
-  int c;
+  // only start the clock if nothing is waiting yet
+  int c = read();
+  if (c >= 0) return c;
   _startMillis = millis();
   do {
     c = read();
@@ -42,7 +50,8 @@ int Stream::timedRead()
 // protected method to peek stream with timeout
 int Stream::timedPeek()
 {
-  int c;
+  int c = peek();
+  if (c >= 0) return c;
   _startMillis = millis();
   do {
     c = peek();
@@ -51,6 +60,30 @@ int Stream::timedPeek()
   return -1;     // -1 indicates timeout
 }
 
+// returns 1 if c can start a number, 0 if it is to be skipped or -1 if
+// the lookahead mode does not allow skipping it
+static int8_t lookaheadStep(int c, LookaheadMode lookahead, bool detectDecimal)
+{
+  if( c == '-' ||
+      (c >= '0' && c <= '9') ||
+      (detectDecimal && c == '.')) return 1;
+
+  switch( lookahead ){
+      case SKIP_NONE: return -1; // Fail code.
+      case SKIP_WHITESPACE:
+          switch( c ){
+              case ' ':
+              case '\t':
+              case '\r':
+              case '\n': break;
+              default: return -1; // Fail code.
+          }
+      case SKIP_ALL:
+          break;
+  }
+  return 0;
+}
+
 // returns peek of the next digit in the stream or -1 if timeout
 // discards non-numeric characters
 int Stream::peekNextDigit(LookaheadMode lookahead, bool detectDecimal)
@@ -58,25 +91,11 @@ int Stream::peekNextDigit(LookaheadMode lookahead, bool detectDecimal)
   int c;
   while (1) {
     c = timedPeek();
+    if (c < 0) return c;
 
-    if( c < 0 ||
-        c == '-' ||
-        (c >= '0' && c <= '9') ||
-        (detectDecimal && c == '.')) return c;
-
-    switch( lookahead ){
-        case SKIP_NONE: return -1; // Fail code.
-        case SKIP_WHITESPACE:
-            switch( c ){
-                case ' ':
-                case '\t':
-                case '\r':
-                case '\n': break;
-                default: return -1; // Fail code.
-            }
-        case SKIP_ALL:
-            break;
-    }
+    int8_t step = lookaheadStep(c, lookahead, detectDecimal);
+    if (step > 0) return c;
+    if (step < 0) return -1;
     read();  // discard non-numeric
   }
 }
@@ -84,6 +103,17 @@ int Stream::peekNextDigit(LookaheadMode lookahead, bool detectDecimal)
 // Public Methods
 //////////////////////////////////////////////////////////////
 
+int Stream::read(uint8_t *buffer, size_t length)
+{
+  size_t count = 0;
+  while (count < length) {
+    int c = read();
+    if (c < 0) break;
+    buffer[count++] = (uint8_t)c;
+  }
+  return count;
+}
+
 void Stream::setTimeout(unsigned long timeout)  // sets the maximum number of milliseconds to wait
 {
   _timeout = timeout;
@@ -129,69 +159,61 @@ bool Stream::findUntil(char *target, size_t targetLen, char *terminator, size_t
 // Once parsing commences, 'ignore' will be skipped in the stream.
 long Stream::parseInt(LookaheadMode lookahead, char ignore)
 {
-  bool isNegative = false;
-  long value = 0;
-  int c;
+  NumberParser number(false, ignore);
+  parseNumber(number, lookahead);
+  return number.toLong(); // zero if timeout
+}
 
-  c = peekNextDigit(lookahead, false);
+// as parseInt but returns a floating point value
+float Stream::parseFloat(LookaheadMode lookahead, char ignore)
+{
+  NumberParser number(true, ignore);
+  parseNumber(number, lookahead);
+  return number.toFloat(); // zero if timeout
+}
+
+// feeds the characters of the next number to the parser, consuming them
+bool Stream::parseNumber(NumberParser &number, LookaheadMode lookahead)
+{
+  int c = peekNextDigit(lookahead, number.acceptsFraction());
   // ignore non numeric leading characters
   if(c < 0)
-    return 0; // zero returned if timeout
-
-  do{
-    if(c == ignore)
-      ; // ignore this character
-    else if(c == '-')
-      isNegative = true;
-    else if(c >= '0' && c <= '9')        // is c a digit?
-      value = value * 10 + c - '0';
+    return false;
+
+  while( c >= 0 && number.feed(c) ){
     read();  // consume the character we got with peek
     c = timedPeek();
   }
-  while( (c >= '0' && c <= '9') || c == ignore );
+  return true;
+}
 
-  if(isNegative)
-    value = -value;
-  return value;
+long Stream::parseInt(const char *buffer, size_t length, size_t *used, LookaheadMode lookahead)
+{
+  NumberParser number(false);
+  size_t n = parseNumber(number, buffer, length, lookahead);
+  if (used) *used = n;
+  return number.toLong();
 }
 
-// as parseInt but returns a floating point value
-float Stream::parseFloat(LookaheadMode lookahead, char ignore)
+float Stream::parseFloat(const char *buffer, size_t length, size_t *used, LookaheadMode lookahead)
 {
-  bool isNegative = false;
-  bool isFraction = false;
-  long value = 0;
-  int c;
-  float fraction = 1.0;
+  NumberParser number(true);
+  size_t n = parseNumber(number, buffer, length, lookahead);
+  if (used) *used = n;
+  return number.toFloat();
+}
 
-  c = peekNextDigit(lookahead, true);
-    // ignore non numeric leading characters
-  if(c < 0)
-    return 0; // zero returned if timeout
-
-  do{
-    if(c == ignore)
-      ; // ignore
-    else if(c == '-')
-      isNegative = true;
-    else if (c == '.')
-      isFraction = true;
-    else if(c >= '0' && c <= '9')  {      // is c a digit?
-      value = value * 10 + c - '0';
-      if(isFraction)
-         fraction *= 0.1;
-    }
-    read();  // consume the character we got with peek
-    c = timedPeek();
+size_t Stream::parseNumber(NumberParser &number, const char *buffer, size_t length, LookaheadMode lookahead)
+{
+  size_t i = 0;
+  for (; i < length; i++) {
+    int8_t step = lookaheadStep(buffer[i], lookahead, number.acceptsFraction());
+    if (step < 0) return i;
+    if (step > 0) break;
   }
-  while( (c >= '0' && c <= '9')  || (c == '.' && !isFraction) || c == ignore );
-
-  if(isNegative)
-    value = -value;
-  if(isFraction)
-    return value * fraction;
-  else
-    return value;
+  while (i < length && number.feed(buffer[i]))
+    i++;
+  return i;
 }
 
 // read characters from stream into buffer
@@ -202,11 +224,17 @@ float Stream::parseFloat(LookaheadMode lookahead, char ignore)
 size_t Stream::readBytes(char *buffer, size_t length)
 {
   size_t count = 0;
+  // the timeout restarts whenever data arrives, as it does per character
+  // in timedRead()
+  _startMillis = millis();
   while (count < length) {
-    int c = timedRead();
-    if (c < 0) break;
-    *buffer++ = (char)c;
-    count++;
+    int n = read((uint8_t *)buffer + count, length - count);
+    if (n > 0) {
+      count += n;
+      _startMillis = millis();
+    } else if (millis() - _startMillis >= _timeout) {
+      break;
+    }
   }
   return count;
 }
@@ -231,12 +259,13 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
 String Stream::readString()
 {
   String ret;
-  int c = timedRead();
-  while (c >= 0)
-  {
-    ret += (char)c;
-    c = timedRead();
-  }
+  char buf[16];
+  size_t n;
+  // a short chunk means readBytes() already waited out the timeout
+  do {
+    n = readBytes(buf, sizeof(buf));
+    ret += StringView(buf, n);
+  } while (n == sizeof(buf));
   return ret;
 }
 
@@ -252,12 +281,43 @@ String Stream::readStringUntil(char terminator)
   return ret;
 }
 
+int Stream::findMulti(StreamMatcher &matcher)
+{
+  matcher.reset();
+  while (1) {
+    int c = timedRead();
+    if (c < 0)
+      return -1;
+    int found = matcher.feed(c);
+    if (found >= 0)
+      return found;
+  }
+}
+
 int Stream::findMulti( struct Stream::MultiTarget *targets, int tCount) {
   // any zero length target string automatically matches and would make
   // a mess of the rest of the algorithm.
+  size_t total = 0;
   for (struct MultiTarget *t = targets; t < targets+tCount; ++t) {
     if (t->len <= 0)
       return t - targets;
+    total += t->len;
+  }
+
+  // Build failure tables on the stack, so that every byte is handled in
+  // constant time per target. Larger sets of targets use the search below,
+  // which needs no tables but walks back through the target on mismatches.
+  if (tCount > 0 && tCount <= FIND_MULTI_MAX_TARGETS && total <= FIND_MULTI_MAX_CHARS) {
+    const char *patterns[FIND_MULTI_MAX_TARGETS];
+    size_t lengths[FIND_MULTI_MAX_TARGETS];
+    uint8_t tables[FIND_MULTI_MAX_CHARS + FIND_MULTI_MAX_TARGETS];
+    uint8_t states[FIND_MULTI_MAX_TARGETS];
+    for (int i = 0; i < tCount; i++) {
+      patterns[i] = targets[i].str;
+      lengths[i] = targets[i].len;
+    }
+    StreamMatcher matcher(patterns, lengths, tCount, tables, sizeof(tables), states);
+    return findMulti(matcher);
   }
 
   while (1) {
@@ -24,6 +24,8 @@
 
 #include <inttypes.h>
 #include "Print.h"
+#include "StreamMatcher.h"
+#include "NumberParser.h"
 
 // compatibility macros for testing
 /*
@@ -44,8 +46,6 @@ enum LookaheadMode{
     SKIP_WHITESPACE // Only tabs, spaces, line feeds & carriage returns are skipped.
 };
 
-#define NO_IGNORE_CHAR  '\x01' // a char not found in a valid ASCII numeric field
-
 class Stream : public Print
 {
   protected:
@@ -59,6 +59,11 @@ class Stream : public Print
     virtual int available() = 0;
     virtual int read() = 0;
     virtual int peek() = 0;
+    virtual int read(uint8_t *buffer, size_t length);
+    // reads up to length bytes that are already available, without waiting,
+    // and returns the number of bytes placed in the buffer. The default reads
+    // them one at a time; classes with a buffer of their own override this
+    // to copy them in blocks.
 
     Stream() {_timeout=1000;}
 
@@ -91,7 +96,18 @@ class Stream : public Print
   // Once parsing commences, 'ignore' will be skipped in the stream.
 
   float parseFloat(LookaheadMode lookahead = SKIP_ALL, char ignore = NO_IGNORE_CHAR);
-  // float version of parseInt
+  // float version of parseInt, which also accepts an exponent ("1.5e3").
+  // Note that an 'e' directly after the digits is read as part of it.
+
+  bool parseNumber(NumberParser &number, LookaheadMode lookahead = SKIP_ALL);
+  // reads a number into a parser prepared with number.begin(), which also
+  // tells whether it overflowed; returns false if no number was found
+
+  static long parseInt(const char *buffer, size_t length, size_t *used = NULL, LookaheadMode lookahead = SKIP_ALL);
+  static float parseFloat(const char *buffer, size_t length, size_t *used = NULL, LookaheadMode lookahead = SKIP_ALL);
+  static size_t parseNumber(NumberParser &number, const char *buffer, size_t length, LookaheadMode lookahead = SKIP_ALL);
+  // as above, but parse the first number in a buffer; used receives the
+  // number of characters consumed, including any skipped before the number
 
   size_t readBytes( char *buffer, size_t length); // read chars from stream into buffer
   size_t readBytes( uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
@@ -103,6 +119,10 @@ class Stream : public Print
   // terminates if length characters have been read, timeout, or if the terminator character  detected
   // returns the number of characters placed in the buffer (0 means no valid data found)
 
+  int findMulti(StreamMatcher &matcher);
+  // reads data from the stream until one of the matcher's patterns is found
+  // returns the index of that pattern, or -1 if timed out
+
   // Arduino String functions to be added here
   String readString();
   String readStringUntil(char terminator);
@@ -0,0 +1,139 @@
+/*
+  StreamMatcher.cpp - Search for several strings at once in a byte stream
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <string.h>
+#include <avr/pgmspace.h>
+#include "StreamMatcher.h"
+
+// The tables hold, for every pattern in turn, its length followed by its
+// KMP failure function: entry q is the length of the longest proper
+// prefix of the first q + 1 pattern characters that is also a suffix of
+// them. The state of a pattern is the number of its characters matched
+// so far.
+
+StreamMatcher::StreamMatcher(const char * const *patterns, uint8_t count,
+                             uint8_t *tables, size_t tableSize, uint8_t *states,
+                             bool progmem)
+  : _patterns(patterns), _tables(tables), _states(states), _count(count), _progmem(progmem)
+{
+  build(NULL, tableSize);
+}
+
+StreamMatcher::StreamMatcher(const char * const *patterns, const size_t *lengths,
+                             uint8_t count, uint8_t *tables, size_t tableSize,
+                             uint8_t *states)
+  : _patterns(patterns), _tables(tables), _states(states), _count(count), _progmem(false)
+{
+  build(lengths, tableSize);
+}
+
+const char *StreamMatcher::pattern(uint8_t i) const
+{
+  if (_progmem)
+    return (const char *)pgm_read_word(_patterns + i);
+  return _patterns[i];
+}
+
+char StreamMatcher::patternChar(const char *p, uint8_t k) const
+{
+  return _progmem ? pgm_read_byte(p + k) : p[k];
+}
+
+void StreamMatcher::build(const size_t *lengths, size_t tableSize)
+{
+  // every pattern needs at least its length byte
+  if (tableSize < _count)
+    _count = tableSize;
+
+  uint8_t *t = _tables;
+  for (uint8_t i = 0; i < _count; i++) {
+    const char *p = pattern(i);
+    size_t len;
+    if (lengths)
+      len = lengths[i];
+    else
+      len = _progmem ? strlen_P(p) : strlen(p);
+    // keep the length bytes of the remaining patterns available, so they
+    // can be skipped even if this one does not fit
+    if (len > 255 || len > tableSize - (_count - i))
+      len = 0;
+    *t++ = len;
+    tableSize--;
+    if (len) {
+      uint8_t k = 0;
+      t[0] = 0;
+      for (uint8_t q = 1; q < len; q++) {
+        char c = patternChar(p, q);
+        while (k > 0 && patternChar(p, k) != c)
+          k = t[k - 1];
+        if (patternChar(p, k) == c)
+          k++;
+        t[q] = k;
+      }
+      t += len;
+      tableSize -= len;
+    }
+  }
+  reset();
+}
+
+void StreamMatcher::reset()
+{
+  memset(_states, 0, _count);
+}
+
+int StreamMatcher::feed(uint8_t c)
+{
+  int found = -1;
+  const uint8_t *t = _tables;
+  for (uint8_t i = 0; i < _count; i++) {
+    uint8_t len = *t++;
+    if (len) {
+      const char *p = pattern(i);
+      uint8_t q = _states[i];
+      while (q > 0 && (uint8_t)patternChar(p, q) != c)
+        q = t[q - 1];
+      if ((uint8_t)patternChar(p, q) == c)
+        q++;
+      if (q == len) {
+        if (found < 0)
+          found = i;
+        // keep going, the end of this match may start the next one
+        q = t[q - 1];
+      }
+      _states[i] = q;
+    }
+    t += len;
+  }
+  return found;
+}
+
+int StreamMatcher::feed(const uint8_t *data, size_t length, size_t *used)
+{
+  for (size_t n = 0; n < length; n++) {
+    int found = feed(data[n]);
+    if (found >= 0) {
+      if (used)
+        *used = n + 1;
+      return found;
+    }
+  }
+  if (used)
+    *used = length;
+  return -1;
+}
@@ -0,0 +1,108 @@
+/*
+  StreamMatcher.h - Search for several strings at once in a byte stream
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef StreamMatcher_h
+#define StreamMatcher_h
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// Watches a byte stream for any of a set of patterns, e.g. the result
+// codes a modem may answer with. The patterns are preprocessed once into
+// KMP failure tables, so every byte costs a small constant amount of work
+// per pattern, no matter how often a partial match falls apart.
+//
+// The matcher keeps a pointer to the pattern array and works in caller
+// supplied storage: one table byte per pattern character plus one per
+// pattern, and one state byte per pattern. StaticStreamMatcher below
+// provides both. With progmem set, the array of pointers and the
+// strings it points to are all read from flash:
+//
+//   const char ok[] PROGMEM = "OK\r\n";
+//   const char error[] PROGMEM = "ERROR\r\n";
+//   const char * const results[] PROGMEM = { ok, error };
+//   StaticStreamMatcher<2, 11> matcher(results, true);
+//   int result = Serial.findMulti(matcher);  // 0, 1 or -1 on timeout
+//
+// Patterns longer than 255 bytes, empty patterns and patterns that no
+// longer fit in the table storage never match.
+class StreamMatcher
+{
+  public:
+    StreamMatcher(const char * const *patterns, uint8_t count,
+                  uint8_t *tables, size_t tableSize, uint8_t *states,
+                  bool progmem = false);
+
+    // forgets any partial matches
+    void reset();
+
+    // feeds one byte; returns the index of a pattern that ends with it,
+    // or -1. If several patterns end on the same byte, the lowest index
+    // is returned.
+    int feed(uint8_t c);
+
+    // feeds bytes until a pattern matches, and returns its index or -1.
+    // If used is not NULL, it receives the number of bytes consumed,
+    // up to and including the end of the match.
+    int feed(const uint8_t *data, size_t length, size_t *used = NULL);
+
+    uint8_t count() const { return _count; }
+
+  private:
+    friend class Stream;
+    // for patterns in RAM with given lengths, which need not be
+    // terminated
+    StreamMatcher(const char * const *patterns, const size_t *lengths,
+                  uint8_t count, uint8_t *tables, size_t tableSize,
+                  uint8_t *states);
+
+    void build(const size_t *lengths, size_t tableSize);
+    const char *pattern(uint8_t i) const;
+    char patternChar(const char *p, uint8_t k) const;
+
+    const char * const *_patterns;
+    uint8_t *_tables;
+    uint8_t *_states;
+    uint8_t _count;
+    bool _progmem;
+};
+
+// Storage for a StaticStreamMatcher. It is a base class listed before
+// StreamMatcher, so that it exists before the StreamMatcher constructor
+// fills in the tables.
+template <uint8_t Count, size_t TotalLength>
+struct StreamMatcherStorage
+{
+  uint8_t _tableStorage[TotalLength + Count];
+  uint8_t _stateStorage[Count];
+};
+
+// A StreamMatcher with its own storage, for Count patterns of at most
+// TotalLength characters together
+template <uint8_t Count, size_t TotalLength>
+class StaticStreamMatcher : private StreamMatcherStorage<Count, TotalLength>, public StreamMatcher
+{
+    typedef StreamMatcherStorage<Count, TotalLength> Storage;
+
+  public:
+    StaticStreamMatcher(const char * const *patterns, bool progmem = false)
+      : Storage(), StreamMatcher(patterns, Count, Storage::_tableStorage,
+                                 sizeof(Storage::_tableStorage), Storage::_stateStorage, progmem) {}
+};
+
+#endif
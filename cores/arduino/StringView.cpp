@@ -0,0 +1,192 @@
+/*
+  StringView.cpp - Non-owning view of a run of characters in RAM or flash
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "StringView.h"
+#include "WString.h"
+
+StringView::StringView(const String &str)
+	: ptr(str.c_str() ? str.c_str() : ""), len(str.length()), flash(false)
+{
+}
+
+/*********************************************/
+/*  Comparison                               */
+/*********************************************/
+
+int StringView::compareTo(const StringView &s) const
+{
+	unsigned int n = len < s.len ? len : s.len;
+	for (unsigned int i = 0; i < n; i++) {
+		unsigned char a = charAt(i);
+		unsigned char b = s.charAt(i);
+		if (a != b) return (int)a - (int)b;
+	}
+	if (len == s.len) return 0;
+	return len < s.len ? -(unsigned char)s.charAt(n) : (unsigned char)charAt(n);
+}
+
+bool StringView::equals(const StringView &s) const
+{
+	if (len != s.len) return false;
+	if (!flash && !s.flash) return memcmp(ptr, s.ptr, len) == 0;
+	if (!s.flash) return memcmp_P(s.ptr, ptr, len) == 0;
+	if (!flash) return memcmp_P(ptr, s.ptr, len) == 0;
+	return compareTo(s) == 0;
+}
+
+bool StringView::equalsIgnoreCase(const StringView &s) const
+{
+	if (len != s.len) return false;
+	for (unsigned int i = 0; i < len; i++) {
+		if (tolower(charAt(i)) != tolower(s.charAt(i))) return false;
+	}
+	return true;
+}
+
+bool StringView::startsWith(const StringView &prefix) const
+{
+	if (prefix.len > len) return false;
+	return substring(0, prefix.len).equals(prefix);
+}
+
+bool StringView::endsWith(const StringView &suffix) const
+{
+	if (suffix.len > len) return false;
+	return substring(len - suffix.len).equals(suffix);
+}
+
+/*********************************************/
+/*  Search                                   */
+/*********************************************/
+
+int StringView::indexOf(char ch, unsigned int fromIndex) const
+{
+	if (fromIndex >= len) return -1;
+	const void *found;
+	if (flash) found = memchr_P(ptr + fromIndex, ch, len - fromIndex);
+	else found = memchr(ptr + fromIndex, ch, len - fromIndex);
+	if (!found) return -1;
+	return (const char *)found - ptr;
+}
+
+int StringView::indexOf(const StringView &s, unsigned int fromIndex) const
+{
+	if (fromIndex > len || s.len > len - fromIndex) return -1;
+	if (s.len == 0) return fromIndex;
+	char first = s.charAt(0);
+	unsigned int last = len - s.len;
+	for (unsigned int i = fromIndex; i <= last; i++) {
+		int at = indexOf(first, i);
+		if (at < 0 || (unsigned int)at > last) break;
+		i = at;
+		if (substring(i, i + s.len).equals(s)) return i;
+	}
+	return -1;
+}
+
+int StringView::lastIndexOf(char ch) const
+{
+	for (unsigned int i = len; i-- > 0; ) {
+		if (charAt(i) == ch) return i;
+	}
+	return -1;
+}
+
+/*********************************************/
+/*  Views                                    */
+/*********************************************/
+
+StringView StringView::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+	if (endIndex > len) endIndex = len;
+	if (beginIndex > endIndex) beginIndex = endIndex;
+	StringView v(*this);
+	v.ptr += beginIndex;
+	v.len = endIndex - beginIndex;
+	return v;
+}
+
+StringView StringView::trim(void) const
+{
+	unsigned int begin = 0, end = len;
+	while (begin < end && isspace(charAt(begin))) begin++;
+	while (end > begin && isspace(charAt(end - 1))) end--;
+	return substring(begin, end);
+}
+
+/*********************************************/
+/*  Conversion                               */
+/*********************************************/
+
+unsigned int StringView::toCharArray(char *buf, unsigned int bufsize) const
+{
+	if (!bufsize || !buf) return 0;
+	unsigned int n = len < bufsize - 1 ? len : bufsize - 1;
+	if (flash) memcpy_P(buf, ptr, n);
+	else memcpy(buf, ptr, n);
+	buf[n] = 0;
+	return n;
+}
+
+long StringView::toInt(void) const
+{
+	// sign and ten digits, anything after that is not a valid long anyway
+	char buf[12 + 1];
+	trim().toCharArray(buf, sizeof(buf));
+	return atol(buf);
+}
+
+float StringView::toFloat(void) const
+{
+	return float(toDouble());
+}
+
+double StringView::toDouble(void) const
+{
+	char buf[32];
+	trim().toCharArray(buf, sizeof(buf));
+	return atof(buf);
+}
+
+String StringView::toString(void) const
+{
+	String s;
+	s.concat(*this);
+	return s;
+}
+
+/*********************************************/
+/*  Tokenizer                                */
+/*********************************************/
+
+bool StringTokenizer::next(StringView &token)
+{
+	if (done) return false;
+	for (unsigned int i = 0; i < rest.len; i++) {
+		if (delims.indexOf(rest.charAt(i)) >= 0) {
+			token = rest.substring(0, i);
+			rest = rest.substring(i + 1);
+			return true;
+		}
+	}
+	// the last field runs to the end of the input
+	token = rest;
+	rest = rest.substring(rest.len);
+	done = true;
+	return true;
+}
@@ -0,0 +1,140 @@
+/*
+  StringView.h - Non-owning view of a run of characters in RAM or flash
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef StringView_h
+#define StringView_h
+#ifdef __cplusplus
+
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+class String;
+class __FlashStringHelper;
+
+// A StringView refers to characters owned by someone else (a char array,
+// a String, a string literal or a F() string in flash) by pointer and
+// length. It never allocates, and substring() and the tokenizer below
+// just return narrower views, so input can be picked apart without
+// touching the heap.
+//
+// The view does not need a terminating '\0', but the characters must stay
+// where they are while the view is used: a view of a String becomes
+// invalid when that String is modified or destroyed.
+class StringView
+{
+public:
+	static const unsigned int npos = (unsigned int)-1;
+
+	StringView() : ptr(""), len(0), flash(false) {}
+	StringView(const char *cstr) : ptr(cstr ? cstr : ""), len(cstr ? strlen(cstr) : 0), flash(false) {}
+	StringView(const char *data, unsigned int length) : ptr(data), len(length), flash(false) {}
+	StringView(const __FlashStringHelper *pstr)
+		: ptr((const char *)pstr), len(pstr ? strlen_P((const char *)pstr) : 0), flash(true) {}
+	StringView(const __FlashStringHelper *pstr, unsigned int length)
+		: ptr((const char *)pstr), len(length), flash(true) {}
+	StringView(const String &str);
+
+	inline unsigned int length(void) const { return len; }
+	inline bool isEmpty(void) const { return len == 0; }
+	// true if data() points to flash (use pgm_read_byte() on it)
+	inline bool isFlash(void) const { return flash; }
+	inline const char *data(void) const { return ptr; }
+
+	// character access, returns 0 past the end
+	char charAt(unsigned int index) const {
+		if (index >= len) return 0;
+		return flash ? pgm_read_byte(ptr + index) : ptr[index];
+	}
+	char operator [] (unsigned int index) const { return charAt(index); }
+
+	// comparison
+	int compareTo(const StringView &s) const;
+	bool equals(const StringView &s) const;
+	bool equalsIgnoreCase(const StringView &s) const;
+	bool operator == (const StringView &rhs) const { return equals(rhs); }
+	bool operator != (const StringView &rhs) const { return !equals(rhs); }
+	bool operator <  (const StringView &rhs) const { return compareTo(rhs) < 0; }
+	bool operator >  (const StringView &rhs) const { return compareTo(rhs) > 0; }
+	bool operator <= (const StringView &rhs) const { return compareTo(rhs) <= 0; }
+	bool operator >= (const StringView &rhs) const { return compareTo(rhs) >= 0; }
+	bool startsWith(const StringView &prefix) const;
+	bool endsWith(const StringView &suffix) const;
+
+	// search, returning the index or -1
+	int indexOf(char ch, unsigned int fromIndex = 0) const;
+	int indexOf(const StringView &s, unsigned int fromIndex = 0) const;
+	int lastIndexOf(char ch) const;
+
+	// narrower views of the same characters
+	StringView substring(unsigned int beginIndex, unsigned int endIndex = npos) const;
+	StringView trim(void) const;
+
+	// conversion
+	long toInt(void) const;
+	float toFloat(void) const;
+	double toDouble(void) const;
+	// copies at most bufsize - 1 characters and a terminating '\0' to buf
+	unsigned int toCharArray(char *buf, unsigned int bufsize) const;
+	String toString(void) const;
+
+private:
+	const char *ptr;
+	unsigned int len;
+	bool flash;
+
+	friend class StringTokenizer;
+};
+
+// Splits a view into fields separated by any of the delimiter characters,
+// e.g. the values of a CSV line or the parameters of an AT response.
+// Empty fields between adjacent delimiters are returned as empty views.
+//
+//	StringTokenizer fields(line, ',');
+//	StringView field;
+//	while (fields.next(field)) { ... }
+class StringTokenizer
+{
+public:
+	StringTokenizer(const StringView &input, char delimiter)
+		: rest(input), delims(&_delimiter, 1), _delimiter(delimiter), done(false) {}
+	StringTokenizer(const StringView &input, const StringView &delimiters)
+		: rest(input), delims(delimiters), _delimiter(0), done(false) {}
+	StringTokenizer(const StringTokenizer &other)
+		: rest(other.rest), delims(other.delims), _delimiter(other._delimiter), done(other.done) {
+		if (other.delims.ptr == &other._delimiter) delims.ptr = &_delimiter;
+	}
+
+	// stores the next field in token; returns false when there are no
+	// more fields
+	bool next(StringView &token);
+	bool hasNext(void) const { return !done; }
+	// the part of the input that has not been split yet
+	StringView remaining(void) const { return rest; }
+
+private:
+	StringTokenizer &operator = (const StringTokenizer &);
+
+	StringView rest;
+	StringView delims;
+	char _delimiter;
+	bool done;
+};
+
+#endif  // __cplusplus
+#endif  // StringView_h
@@ -20,6 +20,8 @@
 */
 
 #include "WString.h"
+#include "Print.h"
+#include "PoolAllocator.h"
 #include <float.h>
 
 /*********************************************/
@@ -64,6 +66,12 @@ String::String(StringSumHelper &&rval)
 }
 #endif
 
+String::String(const StringView &view)
+{
+	init();
+	if (reserve(view.length())) concat(view);
+}
+
 String::String(char c)
 {
 	init();
@@ -133,7 +141,7 @@ String::String(double value, unsigned char decimalPlaces)
 
 String::~String()
 {
-	if (buffer) free(buffer);
+	if (buffer) poolFree(buffer);
 }
 
 /*********************************************/
@@ -149,7 +157,7 @@ inline void String::init(void)
 
 void String::invalidate(void)
 {
-	if (buffer) free(buffer);
+	if (buffer) poolFree(buffer);
 	buffer = NULL;
 	capacity = len = 0;
 }
@@ -166,7 +174,7 @@ unsigned char String::reserve(unsigned int size)
 
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
-	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	char *newbuffer = (char *)poolRealloc(buffer, maxStrLen + 1);
 	if (newbuffer) {
 		buffer = newbuffer;
 		capacity = maxStrLen;
@@ -175,6 +183,22 @@ unsigned char String::changeBuffer(unsigned int maxStrLen)
 	return 0;
 }
 
+// Like reserve(), but when the buffer has to grow it grows by half its
+// current size at once, so that appending one piece at a time (for
+// example in Stream::readString()) takes amortised linear time instead of
+// a realloc per append. If the larger block is not available, the exact
+// size is tried as well, since the heap is small.
+unsigned char String::grow(unsigned int maxStrLen)
+{
+	if (buffer && capacity >= maxStrLen) return 1;
+	unsigned int cap = capacity;
+	unsigned int amortised = cap + (cap >> 1);
+	if (amortised > maxStrLen && amortised > cap) {
+		if (changeBuffer(amortised)) return 1;
+	}
+	return reserve(maxStrLen);
+}
+
 /*********************************************/
 /*  Copy and Move                            */
 /*********************************************/
@@ -211,7 +235,7 @@ void String::move(String &rhs)
 			rhs.len = 0;
 			return;
 		} else {
-			free(buffer);
+			poolFree(buffer);
 		}
 	}
 	buffer = rhs.buffer;
@@ -277,8 +301,14 @@ unsigned char String::concat(const char *cstr, unsigned int length)
 	unsigned int newlen = len + length;
 	if (!cstr) return 0;
 	if (length == 0) return 1;
-	if (!reserve(newlen)) return 0;
-	strcpy(buffer + len, cstr);
+	// cstr may point into our own buffer (s += s), which grow() can move
+	if (buffer && cstr >= buffer && cstr <= buffer + len) {
+		unsigned int offset = cstr - buffer;
+		if (!grow(newlen)) return 0;
+		cstr = buffer + offset;
+	} else if (!grow(newlen)) return 0;
+	memmove(buffer + len, cstr, length);
+	buffer[newlen] = 0;
 	len = newlen;
 	return 1;
 }
@@ -354,12 +384,24 @@ unsigned char String::concat(const __FlashStringHelper * str)
 	int length = strlen_P((const char *) str);
 	if (length == 0) return 1;
 	unsigned int newlen = len + length;
-	if (!reserve(newlen)) return 0;
+	if (!grow(newlen)) return 0;
 	strcpy_P(buffer + len, (const char *) str);
 	len = newlen;
 	return 1;
 }
 
+unsigned char String::concat(const StringView &view)
+{
+	if (!view.isFlash()) return concat(view.data(), view.length());
+	if (view.isEmpty()) return 1;
+	unsigned int newlen = len + view.length();
+	if (!grow(newlen)) return 0;
+	memcpy_P(buffer + len, view.data(), view.length());
+	buffer[newlen] = 0;
+	len = newlen;
+	return 1;
+}
+
 /*********************************************/
 /*  Concatenate                              */
 /*********************************************/
@@ -599,12 +641,10 @@ int String::lastIndexOf( char theChar ) const
 int String::lastIndexOf(char ch, unsigned int fromIndex) const
 {
 	if (fromIndex >= len) return -1;
-	char tempchar = buffer[fromIndex + 1];
-	buffer[fromIndex + 1] = '\0';
-	char* temp = strrchr( buffer, ch );
-	buffer[fromIndex + 1] = tempchar;
-	if (temp == NULL) return -1;
-	return temp - buffer;
+	for (int i = fromIndex; i >= 0; i--) {
+		if (buffer[i] == ch) return i;
+	}
+	return -1;
 }
 
 int String::lastIndexOf(const String &s2) const
@@ -657,6 +697,12 @@ void String::replace(char find, char replace)
 void String::replace(const String& find, const String& replace)
 {
 	if (len == 0 || find.len == 0) return;
+	if (&find == this || &replace == this) {
+		// The buffer is rewritten in place below, so work from a copy
+		String self(*this);
+		this->replace(&find == this ? self : find, &replace == this ? self : replace);
+		return;
+	}
 	int diff = replace.len - find.len;
 	char *readFrom = buffer;
 	char *foundAt;
@@ -667,34 +713,63 @@ void String::replace(const String& find, const String& replace)
 		}
 	} else if (diff < 0) {
 		char *writeTo = buffer;
+		unsigned int newlen = len;
 		while ((foundAt = strstr(readFrom, find.buffer)) != NULL) {
 			unsigned int n = foundAt - readFrom;
-			memcpy(writeTo, readFrom, n);
+			memmove(writeTo, readFrom, n);
 			writeTo += n;
 			memcpy(writeTo, replace.buffer, replace.len);
 			writeTo += replace.len;
 			readFrom = foundAt + find.len;
-			len += diff;
+			newlen += diff;
 		}
-		strcpy(writeTo, readFrom);
+		memmove(writeTo, readFrom, strlen(readFrom) + 1);
+		len = newlen;
 	} else {
-		unsigned int size = len; // compute size needed for result
+		unsigned int oldlen = len;
+		unsigned int size = oldlen; // compute size needed for result
 		while ((foundAt = strstr(readFrom, find.buffer)) != NULL) {
 			readFrom = foundAt + find.len;
 			size += diff;
 		}
-		if (size == len) return;
+		if (size == oldlen) return;
 		if (size > capacity && !changeBuffer(size)) return; // XXX: tell user!
-		int index = len - 1;
-		while (index >= 0 && (index = lastIndexOf(find, index)) >= 0) {
-			readFrom = buffer + index + find.len;
-			memmove(readFrom + diff, readFrom, len - (readFrom - buffer));
-			len += diff;
-			buffer[len] = 0;
-			memcpy(buffer + index, replace.buffer, replace.len);
-			index--;
+		// Move the original text (and its terminator) to the end of the
+		// enlarged buffer, then rebuild the result from the front in one
+		// pass. Every match so far has grown the output by diff, and the
+		// text was moved up by the total growth, so the write position
+		// can never overtake the text that is still to be read.
+		char *buf = buffer;
+		readFrom = buf + (size - oldlen);
+		memmove(readFrom, buf, oldlen + 1);
+		char *writeTo = buf;
+		while ((foundAt = strstr(readFrom, find.buffer)) != NULL) {
+			unsigned int n = foundAt - readFrom;
+			memmove(writeTo, readFrom, n);
+			writeTo += n;
+			memcpy(writeTo, replace.buffer, replace.len);
+			writeTo += replace.len;
+			readFrom = foundAt + find.len;
 		}
+		memmove(writeTo, readFrom, strlen(readFrom) + 1);
+		len = size;
+	}
+}
+
+size_t String::replace(const String& find, const String& replace, Print &out) const
+{
+	if (!buffer) return 0;
+	if (find.len == 0) return out.write(buffer, len);
+	size_t n = 0;
+	const char *readFrom = buffer;
+	const char *foundAt;
+	while ((foundAt = strstr(readFrom, find.buffer)) != NULL) {
+		n += out.write(readFrom, foundAt - readFrom);
+		n += out.write(replace.buffer, replace.len);
+		readFrom = foundAt + find.len;
 	}
+	n += out.write(readFrom, buffer + len - readFrom);
+	return n;
 }
 
 void String::remove(unsigned int index){
@@ -738,7 +813,7 @@ void String::trim(void)
 	char *end = buffer + len - 1;
 	while (isspace(*end) && end >= begin) end--;
 	len = end + 1 - begin;
-	if (begin > buffer) memcpy(buffer, begin, len);
+	if (begin > buffer) memmove(buffer, begin, len);
 	buffer[len] = 0;
 }
 
@@ -27,6 +27,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <avr/pgmspace.h>
+#include "StringView.h"
 
 // When compiling programs with this class, the following gcc parameters
 // dramatically increase performance and memory (RAM) efficiency, typically
@@ -35,6 +36,7 @@
 //     -std=c++0x
 
 class __FlashStringHelper;
+class Print;
 #define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
 
 // An inherited class for holding the result of a concatenation.  These
@@ -66,6 +68,7 @@ public:
 	String(String &&rval);
 	String(StringSumHelper &&rval);
 	#endif
+	explicit String(const StringView &view);
 	explicit String(char c);
 	explicit String(unsigned char, unsigned char base=10);
 	explicit String(int, unsigned char base=10);
@@ -110,6 +113,7 @@ public:
 	unsigned char concat(float num);
 	unsigned char concat(double num);
 	unsigned char concat(const __FlashStringHelper * str);
+	unsigned char concat(const StringView &view);
 
 	// if there's not enough memory for the concatenated value, the string
 	// will be left unchanged (but this isn't signalled in any way)
@@ -124,6 +128,7 @@ public:
 	String & operator += (float num)		{concat(num); return (*this);}
 	String & operator += (double num)		{concat(num); return (*this);}
 	String & operator += (const __FlashStringHelper *str){concat(str); return (*this);}
+	String & operator += (const StringView &view)	{concat(view); return (*this);}
 
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, const String &rhs);
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, const char *cstr);
@@ -142,10 +147,16 @@ public:
 	int compareTo(const String &s) const;
 	unsigned char equals(const String &s) const;
 	unsigned char equals(const char *cstr) const;
+	unsigned char equals(const StringView &view) const {return StringView(*this).equals(view);}
+	unsigned char equals(const __FlashStringHelper *pstr) const {return equals(StringView(pstr));}
 	unsigned char operator == (const String &rhs) const {return equals(rhs);}
 	unsigned char operator == (const char *cstr) const {return equals(cstr);}
+	unsigned char operator == (const StringView &rhs) const {return equals(rhs);}
+	unsigned char operator == (const __FlashStringHelper *rhs) const {return equals(rhs);}
 	unsigned char operator != (const String &rhs) const {return !equals(rhs);}
 	unsigned char operator != (const char *cstr) const {return !equals(cstr);}
+	unsigned char operator != (const StringView &rhs) const {return !equals(rhs);}
+	unsigned char operator != (const __FlashStringHelper *rhs) const {return !equals(rhs);}
 	unsigned char operator <  (const String &rhs) const;
 	unsigned char operator >  (const String &rhs) const;
 	unsigned char operator <= (const String &rhs) const;
@@ -184,6 +195,9 @@ public:
 	// modification
 	void replace(char find, char replace);
 	void replace(const String& find, const String& replace);
+	// writes the string with every occurrence of find replaced to out,
+	// without building the result in RAM; returns the bytes written
+	size_t replace(const String& find, const String& replace, Print &out) const;
 	void remove(unsigned int index);
 	void remove(unsigned int index, unsigned int count);
 	void toLowerCase(void);
@@ -203,6 +217,7 @@ protected:
 	void init(void);
 	void invalidate(void);
 	unsigned char changeBuffer(unsigned int maxStrLen);
+	unsigned char grow(unsigned int maxStrLen);
 	unsigned char concat(const char *cstr, unsigned int length);
 
 	// copy and move
@@ -16,16 +16,21 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <stdint.h>
+
 /**
- * Empty yield() hook.
+ * Default yield() hook.
  *
  * This function is intended to be used by library writers to build
  * libraries or sketches that supports cooperative threads.
  *
  * Its defined as a weak symbol and it can be redefined to implement a
- * real cooperative scheduler.
+ * real cooperative scheduler. By default it runs the events posted
+ * with postEvent(), if anything posts them.
  */
-static void __empty() {
-	// Empty
+extern uint8_t runEvents(void) __attribute__((weak));
+
+static void __yield() {
+	if (runEvents) runEvents();
 }
-void yield(void) __attribute__ ((weak, alias("__empty")));
+void yield(void) __attribute__ ((weak, alias("__yield")));
@@ -30,6 +30,18 @@ void initVariant() { }
 void setupUSB() __attribute__((weak));
 void setupUSB() { }
 
+// Defined in wiring_sleep.c, which is only linked in when the sketch
+// calls loopIdle().
+extern "C" void idleSleepRun(void) __attribute__((weak));
+
+// Defined in wiring_events.c, which is only linked in when something
+// posts events.
+extern "C" uint8_t runEvents(void) __attribute__((weak));
+
+// Defined in wiring_memory_guard.c, which is only linked in when the
+// sketch calls setSramFaultHandler().
+extern "C" void memoryGuardRun(void) __attribute__((weak));
+
 int main(void)
 {
 	init();
@@ -44,7 +56,10 @@ int main(void)
     
 	for (;;) {
 		loop();
+		if (memoryGuardRun) memoryGuardRun();
 		if (serialEventRun) serialEventRun();
+		if (runEvents) runEvents();
+		if (idleSleepRun) idleSleepRun();
 	}
         
 	return 0;
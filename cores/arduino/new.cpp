@@ -17,6 +17,7 @@
 */
 
 #include "new.h"
+#include "PoolAllocator.h"
 
 // The C++ spec dictates that allocation failure should cause the
 // (non-nothrow version of the) operator new to throw an exception.
@@ -41,7 +42,7 @@ static void * new_helper(std::size_t size) {
   // malloc does not guarantee this
   if (size == 0)
     size = 1;
-  return malloc(size);
+  return poolMalloc(size);
 }
 
 void * operator new(std::size_t size) {
@@ -85,7 +86,7 @@ void * operator new[](std::size_t size, void *place) noexcept {
 }
 
 void operator delete(void * ptr) noexcept {
-  free(ptr);
+  poolFree(ptr);
 }
 void operator delete[](void * ptr) noexcept {
   operator delete(ptr);
@@ -62,6 +62,25 @@ ISR(TIMER0_OVF_vect)
 	timer0_overflow_count++;
 }
 
+// Accounts for time during which timer 0 was stopped, e.g. in power-down
+// sleep, as if the overflow interrupt had run for it, so that millis() and
+// micros() stay in step. The part of an overflow period left over is
+// carried to the next call.
+void timer0Advance(unsigned long us)
+{
+	static unsigned int carry_us;
+	uint8_t oldSREG = SREG;
+	cli();
+	us += carry_us;
+	unsigned long overflows = us / MICROSECONDS_PER_TIMER0_OVERFLOW;
+	carry_us = us - overflows * MICROSECONDS_PER_TIMER0_OVERFLOW;
+	unsigned long f = timer0_fract + overflows * FRACT_INC;
+	timer0_millis += overflows * MILLIS_INC + f / FRACT_MAX;
+	timer0_fract = f % FRACT_MAX;
+	timer0_overflow_count += overflows;
+	SREG = oldSREG;
+}
+
 unsigned long millis()
 {
 	unsigned long m;
@@ -240,6 +259,10 @@ void delayMicroseconds(unsigned int us)
 
 void init()
 {
+	// fill unused SRAM with a pattern, for sramFreeMin() and friends;
+	// only linked in when the sketch uses one of them
+	if (paintFreeMemory) paintFreeMemory();
+
 	// this needs to be called before setup() or some functions won't
 	// work there
 	sei();
@@ -0,0 +1,195 @@
+/*
+  wiring_events.c - queue for work deferred from interrupts
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+
+// A ring of handler/argument pairs. Interrupt handlers do not nest, so
+// posts from them are already serialized; a post from the sketch only
+// blocks interrupts while it writes its slot. runEvents() is the only
+// reader and removes an event before running it, so handlers can post
+// again, even to themselves.
+//
+// main() and the default yield() call runEvents() through weak
+// references, so none of this is linked into sketches that never post.
+
+#if !defined(EVENT_QUEUE_SIZE)
+#define EVENT_QUEUE_SIZE 16
+#endif
+
+#if (EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1)) || EVENT_QUEUE_SIZE > 128
+#error EVENT_QUEUE_SIZE must be a power of two no larger than 128
+#endif
+
+struct event {
+	eventFuncPtr handler;
+	uint16_t arg;
+};
+
+static struct event queue[EVENT_QUEUE_SIZE];
+static volatile uint8_t queue_head;
+static volatile uint8_t queue_tail;
+static volatile uint8_t queue_dropped;
+static bool running;
+
+bool postEvent(eventFuncPtr handler, uint16_t arg)
+{
+	bool posted = false;
+	uint8_t oldSREG = SREG;
+	cli();
+	uint8_t head = queue_head;
+	if ((uint8_t)(head - queue_tail) < EVENT_QUEUE_SIZE) {
+		struct event *e = &queue[head & (EVENT_QUEUE_SIZE - 1)];
+		e->handler = handler;
+		e->arg = arg;
+		queue_head = head + 1;
+		posted = true;
+	} else if (queue_dropped != 255) {
+		queue_dropped++;
+	}
+	SREG = oldSREG;
+	return posted;
+}
+
+bool eventsPending(void)
+{
+	return queue_tail != queue_head;
+}
+
+uint8_t runEvents(void)
+{
+	// a handler calling delay() ends up here again through yield()
+	if (running)
+		return 0;
+	running = true;
+
+	uint8_t count = 0;
+	uint8_t tail = queue_tail;
+	while (tail != queue_head) {
+		struct event e = queue[tail & (EVENT_QUEUE_SIZE - 1)];
+		queue_tail = ++tail;
+		e.handler(e.arg);
+		count++;
+	}
+
+	running = false;
+	return count;
+}
+
+uint8_t eventsDropped(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	uint8_t dropped = queue_dropped;
+	queue_dropped = 0;
+	SREG = oldSREG;
+	return dropped;
+}
+
+// attachInterruptDeferred(): the interrupt itself only counts and, on the
+// first trigger since the handler last ran, posts one event. However fast
+// the pin triggers, it takes a single queue slot, and the handler learns
+// from its argument how many triggers it stands for.
+
+static eventFuncPtr deferred_handler[EXTERNAL_NUM_INTERRUPTS];
+static volatile uint16_t deferred_count[EXTERNAL_NUM_INTERRUPTS];
+
+static void runDeferred(uint16_t interruptNum)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	uint16_t count = deferred_count[interruptNum];
+	deferred_count[interruptNum] = 0;
+	SREG = oldSREG;
+	eventFuncPtr handler = deferred_handler[interruptNum];
+	if (handler && count)
+		handler(count);
+}
+
+static void deferInterrupt(uint8_t interruptNum)
+{
+	uint16_t count = deferred_count[interruptNum];
+	if (count == 0) {
+		// if the queue is full, the next trigger tries again
+		if (!postEvent(runDeferred, interruptNum))
+			return;
+	}
+	if (count != 0xFFFF)
+		deferred_count[interruptNum] = count + 1;
+}
+
+static void deferred0(void) { deferInterrupt(0); }
+#if EXTERNAL_NUM_INTERRUPTS > 1
+static void deferred1(void) { deferInterrupt(1); }
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 2
+static void deferred2(void) { deferInterrupt(2); }
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 3
+static void deferred3(void) { deferInterrupt(3); }
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 4
+static void deferred4(void) { deferInterrupt(4); }
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 5
+static void deferred5(void) { deferInterrupt(5); }
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 6
+static void deferred6(void) { deferInterrupt(6); }
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 7
+static void deferred7(void) { deferInterrupt(7); }
+#endif
+
+static const voidFuncPtr deferred_isr[EXTERNAL_NUM_INTERRUPTS] PROGMEM = {
+	deferred0,
+#if EXTERNAL_NUM_INTERRUPTS > 1
+	deferred1,
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 2
+	deferred2,
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 3
+	deferred3,
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 4
+	deferred4,
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 5
+	deferred5,
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 6
+	deferred6,
+#endif
+#if EXTERNAL_NUM_INTERRUPTS > 7
+	deferred7,
+#endif
+};
+
+void attachInterruptDeferred(uint8_t interruptNum, eventFuncPtr handler, int mode)
+{
+	if (interruptNum >= EXTERNAL_NUM_INTERRUPTS)
+		return;
+	uint8_t oldSREG = SREG;
+	cli();
+	deferred_handler[interruptNum] = handler;
+	deferred_count[interruptNum] = 0;
+	SREG = oldSREG;
+	attachInterrupt(interruptNum, (voidFuncPtr)pgm_read_word(&deferred_isr[interruptNum]), mode);
+}
@@ -0,0 +1,125 @@
+/*
+  wiring_memory.c - SRAM usage instrumentation
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+
+// Nothing here is referenced by the rest of the core except through weak
+// references, so sketches that do not use these functions do not pay
+// for the painting in init(). The fault check is in wiring_memory_guard.c.
+//
+// The heap grows up from the end of .bss and the stack grows down from
+// RAMEND. init() fills the gap between them with a canary pattern, so the
+// deepest point the stack has ever reached can later be found as the
+// lowest byte above the heap that no longer holds the pattern.
+//
+// Freed memory at the top of the heap no longer holds the pattern either,
+// so the scan starts from the highest heap top seen so far. It is sampled
+// whenever one of the functions below runs, so a heap that grew and
+// shrank again in between can make the stack look deeper than it was.
+
+// byte written to free SRAM
+#define MEMORY_CANARY 0xC5
+
+// bytes just below the stack pointer that are left alone while painting
+#define MEMORY_CANARY_GUARD 16
+
+extern char __heap_start;
+extern char *__brkval;
+
+static uint8_t *heap_top_max;
+
+static uint8_t *currentHeapTop(void)
+{
+	uint8_t *top = (uint8_t *)(__brkval ? __brkval : &__heap_start);
+	if (top > heap_top_max)
+		heap_top_max = top;
+	return heap_top_max;
+}
+
+// Lowest address the stack has reached. Only the heap top and SP are
+// read with interrupts disabled; the scan can cover the whole gap, up to
+// about 2 KB, so it runs with them enabled. An interrupt that goes deeper
+// while it runs is simply not seen this time.
+static uint8_t *stackLimit(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	uint8_t *p = currentHeapTop();
+	uint8_t *sp = (uint8_t *)SP;
+	SREG = oldSREG;
+	while (p < sp && *p == MEMORY_CANARY)
+		p++;
+	return p;
+}
+
+void paintFreeMemory(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	uint8_t *p = currentHeapTop();
+	uint8_t *end = (uint8_t *)SP - MEMORY_CANARY_GUARD;
+	while (p < end)
+		*p++ = MEMORY_CANARY;
+	SREG = oldSREG;
+}
+
+size_t sramFree(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	uint8_t *top = (uint8_t *)(__brkval ? __brkval : &__heap_start);
+	size_t gap = (uint8_t *)SP - top;
+	SREG = oldSREG;
+	return gap;
+}
+
+size_t sramFreeMin(void)
+{
+	uint8_t *limit = stackLimit();
+	return limit - heap_top_max;
+}
+
+size_t sramStackHighWater(void)
+{
+	return (uint8_t *)RAMEND + 1 - stackLimit();
+}
+
+void *sramHeapTop(void)
+{
+	return __brkval ? __brkval : &__heap_start;
+}
+
+// Whether the margin bytes above the heap still hold the pattern, i.e.
+// the stack has never come that close. Short, so it runs with interrupts
+// disabled.
+bool memoryMarginIntact(size_t margin)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	uint8_t *p = currentHeapTop();
+	uint8_t *end = p + margin;
+	bool intact = (uint8_t *)SP >= end;
+	while (intact && p < end) {
+		if (*p++ != MEMORY_CANARY)
+			intact = false;
+	}
+	SREG = oldSREG;
+	return intact;
+}
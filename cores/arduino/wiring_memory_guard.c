@@ -0,0 +1,91 @@
+/*
+  wiring_memory_guard.c - stack overflow check for setSramFaultHandler()
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+
+// Only linked in by setSramFaultHandler(). Two checks look for the stack
+// running into the heap:
+//
+// - the timer 0 compare B interrupt, once per timer 0 period (about a
+//   millisecond), compares SP with the heap top plus the margin. This
+//   catches a sketch stuck or recursing inside loop(). Timer 0 runs for
+//   millis(), and the compare interrupt fires whatever OCR0B holds, so
+//   PWM on its pin is unaffected.
+// - memoryGuardRun(), which main() calls after every loop(), checks that
+//   the canary painted by init() is intact within the margin, so that a
+//   near miss between two interrupts is still seen.
+//
+// The handler is called once, from whichever check fires first, and then
+// cleared. From the interrupt it runs with interrupts disabled.
+
+#if defined(TIMER0_COMPB_vect) && defined(TIMSK0) && defined(OCIE0B)
+#define MEMORY_GUARD_TICK
+#endif
+
+extern char __heap_start;
+extern char *__brkval;
+
+static uint16_t fault_margin;
+static void (*volatile memory_fault_handler)(void);
+
+static void memoryFault(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	void (*handler)(void) = memory_fault_handler;
+	memory_fault_handler = NULL;
+#ifdef MEMORY_GUARD_TICK
+	TIMSK0 &= ~_BV(OCIE0B);
+#endif
+	SREG = oldSREG;
+	if (handler)
+		handler();
+}
+
+void setSramFaultHandler(void (*handler)(void), size_t margin)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	fault_margin = margin;
+	memory_fault_handler = handler;
+#ifdef MEMORY_GUARD_TICK
+	if (handler)
+		TIMSK0 |= _BV(OCIE0B);
+	else
+		TIMSK0 &= ~_BV(OCIE0B);
+#endif
+	SREG = oldSREG;
+}
+
+#ifdef MEMORY_GUARD_TICK
+ISR(TIMER0_COMPB_vect)
+{
+	uint8_t *top = (uint8_t *)(__brkval ? __brkval : &__heap_start);
+	if ((uint8_t *)SP < top + fault_margin)
+		memoryFault();
+}
+#endif
+
+// Called by main() after every loop() while this file is linked in
+void memoryGuardRun(void)
+{
+	if (memory_fault_handler && !memoryMarginIntact(fault_margin))
+		memoryFault();
+}
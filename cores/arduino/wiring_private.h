@@ -41,6 +41,16 @@ extern "C"{
 #define sbi(sfr, bit) (_SFR_BYTE(sfr) |= _BV(bit))
 #endif
 
+// disconnects a pin's timer output, see wiring_digital.c
+void turnOffPWM(uint8_t timer);
+
+void paintFreeMemory(void) __attribute__((weak));
+void memoryGuardRun(void);
+bool memoryMarginIntact(size_t margin);
+
+void timer0Advance(unsigned long us);
+bool eventsPending(void) __attribute__((weak));
+
 uint32_t countPulseASM(volatile uint8_t *port, uint8_t bit, uint8_t stateMask, unsigned long maxloops);
 
 #define EXTERNAL_INT_0 0
@@ -22,35 +22,225 @@
 
 #include "wiring_private.h"
 
+// shiftOut() and shiftIn() look up the port registers and bit masks of both
+// pins once per call and then clock each byte out of an unrolled loop with
+// interrupts disabled, instead of paying for a digitalWrite()/digitalRead()
+// lookup on every edge. A byte takes well under 100 cycles this way.
+//
+// When the pins happen to be the hardware SPI pins (MOSI/SCK for shiftOut,
+// MISO/SCK for shiftIn), the SPI peripheral is borrowed for each byte and
+// its previous configuration is put back afterwards. This is only done when
+// it cannot disturb anything else: SS must be an output (or the SPI would
+// drop into slave mode) and the SPI pin that is not part of the transfer
+// must not be used as an output. Define SHIFT_NO_HARDWARE_SPI to always
+// bit-bang, or set SHIFT_SPI_CLOCK_DIV to 2, 4, 8, 16, 32, 64 or 128 to pick
+// the SCK rate used by the hardware path (F_CPU / 4 by default).
+
+#if defined(SPDR) && defined(PIN_SPI_SS) && defined(PIN_SPI_MOSI) && \
+    defined(PIN_SPI_MISO) && defined(PIN_SPI_SCK) && !defined(SHIFT_NO_HARDWARE_SPI)
+#define SHIFT_HAS_HARDWARE_SPI
+
+#ifndef SHIFT_SPI_CLOCK_DIV
+#define SHIFT_SPI_CLOCK_DIV 4
+#endif
+
+#if SHIFT_SPI_CLOCK_DIV == 2
+#define SHIFT_SPCR_CLOCK 0
+#define SHIFT_SPSR_CLOCK _BV(SPI2X)
+#elif SHIFT_SPI_CLOCK_DIV == 4
+#define SHIFT_SPCR_CLOCK 0
+#define SHIFT_SPSR_CLOCK 0
+#elif SHIFT_SPI_CLOCK_DIV == 8
+#define SHIFT_SPCR_CLOCK _BV(SPR0)
+#define SHIFT_SPSR_CLOCK _BV(SPI2X)
+#elif SHIFT_SPI_CLOCK_DIV == 16
+#define SHIFT_SPCR_CLOCK _BV(SPR0)
+#define SHIFT_SPSR_CLOCK 0
+#elif SHIFT_SPI_CLOCK_DIV == 32
+#define SHIFT_SPCR_CLOCK _BV(SPR1)
+#define SHIFT_SPSR_CLOCK _BV(SPI2X)
+#elif SHIFT_SPI_CLOCK_DIV == 64
+#define SHIFT_SPCR_CLOCK _BV(SPR1)
+#define SHIFT_SPSR_CLOCK 0
+#elif SHIFT_SPI_CLOCK_DIV == 128
+#define SHIFT_SPCR_CLOCK (_BV(SPR1) | _BV(SPR0))
+#define SHIFT_SPSR_CLOCK 0
+#else
+#error "SHIFT_SPI_CLOCK_DIV must be 2, 4, 8, 16, 32, 64 or 128"
+#endif
+
+static uint8_t pinIsOutput(uint8_t pin)
+{
+	return *portModeRegister(digitalPinToPort(pin)) & digitalPinToBitMask(pin);
+}
+
+// Sends and receives one byte on the SPI peripheral with the given
+// SPCR configuration. Must be called with interrupts disabled; the
+// previous SPCR/SPSR contents are restored before returning.
+static uint8_t shiftHardwareByte(uint8_t spcr, uint8_t data)
+{
+	uint8_t oldSPCR = SPCR;
+	uint8_t oldSPSR = SPSR;
+
+	SPCR = spcr;
+	SPSR = SHIFT_SPSR_CLOCK;
+	SPDR = data;
+	asm volatile("nop"); // See SPIClass::transfer(uint8_t)
+	while (!(SPSR & _BV(SPIF))) ;
+	data = SPDR;
+
+	SPCR = oldSPCR;
+	SPSR = oldSPSR;
+	return data;
+}
+#endif
+
+static uint8_t reverseBits(uint8_t b)
+{
+	b = (b >> 4) | (b << 4);
+	b = ((b & 0xCC) >> 2) | ((b & 0x33) << 2);
+	b = ((b & 0xAA) >> 1) | ((b & 0x55) << 1);
+	return b;
+}
+
 uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) {
+	uint8_t dataPort = digitalPinToPort(dataPin);
+	uint8_t clockPort = digitalPinToPort(clockPin);
+	uint8_t timer;
 	uint8_t value = 0;
-	uint8_t i;
-
-	for (i = 0; i < 8; ++i) {
-		digitalWrite(clockPin, HIGH);
-		if (bitOrder == LSBFIRST)
-			value |= digitalRead(dataPin) << i;
-		else
-			value |= digitalRead(dataPin) << (7 - i);
-		digitalWrite(clockPin, LOW);
+
+	if (dataPort == NOT_A_PIN || clockPort == NOT_A_PIN) return 0;
+
+	// Release both pins from PWM once, like digitalRead()/digitalWrite() would
+	timer = digitalPinToTimer(dataPin);
+	if (timer != NOT_ON_TIMER) turnOffPWM(timer);
+	timer = digitalPinToTimer(clockPin);
+	if (timer != NOT_ON_TIMER) turnOffPWM(timer);
+
+	volatile uint8_t *in = portInputRegister(dataPort);
+	uint8_t dataMask = digitalPinToBitMask(dataPin);
+	volatile uint8_t *clk = portOutputRegister(clockPort);
+	uint8_t clockMask = digitalPinToBitMask(clockPin);
+	uint8_t clockUnmask = ~clockMask;
+
+	uint8_t oldSREG = SREG;
+	cli();
+
+#if defined(SHIFT_HAS_HARDWARE_SPI)
+	// The bit-banged loop samples while SCK is high, i.e. just before the
+	// falling edge, which is SPI mode 1 (CPOL = 0, CPHA = 1).
+	if (dataPin == PIN_SPI_MISO && clockPin == PIN_SPI_SCK &&
+	    pinIsOutput(PIN_SPI_SCK) && pinIsOutput(PIN_SPI_SS) &&
+	    !pinIsOutput(PIN_SPI_MOSI)) {
+		*clk &= clockUnmask;
+		value = shiftHardwareByte(_BV(SPE) | _BV(MSTR) | _BV(CPHA) | SHIFT_SPCR_CLOCK, 0);
+		SREG = oldSREG;
+		return bitOrder == LSBFIRST ? reverseBits(value) : value;
 	}
-	return value;
+#endif
+
+	// The nops give the shifted device time to drive the next bit, and the
+	// input synchronizer time to see it, after the rising clock edge.
+#define SHIFT_IN_BIT(b) \
+	*clk |= clockMask; \
+	_NOP(); _NOP(); \
+	if (*in & dataMask) value |= (b); \
+	*clk &= clockUnmask;
+
+	SHIFT_IN_BIT(0x80);
+	SHIFT_IN_BIT(0x40);
+	SHIFT_IN_BIT(0x20);
+	SHIFT_IN_BIT(0x10);
+	SHIFT_IN_BIT(0x08);
+	SHIFT_IN_BIT(0x04);
+	SHIFT_IN_BIT(0x02);
+	SHIFT_IN_BIT(0x01);
+
+#undef SHIFT_IN_BIT
+
+	SREG = oldSREG;
+
+	// Bits were collected MSB first, so LSBFIRST just needs a reversal
+	return bitOrder == LSBFIRST ? reverseBits(value) : value;
 }
 
-void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+void shiftOutBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buf, size_t len)
 {
-	uint8_t i;
-
-	for (i = 0; i < 8; i++)  {
-		if (bitOrder == LSBFIRST) {
-			digitalWrite(dataPin, val & 1);
-			val >>= 1;
-		} else {	
-			digitalWrite(dataPin, (val & 128) != 0);
-			val <<= 1;
+	uint8_t dataPort = digitalPinToPort(dataPin);
+	uint8_t clockPort = digitalPinToPort(clockPin);
+	uint8_t timer;
+
+	if (dataPort == NOT_A_PIN || clockPort == NOT_A_PIN) return;
+
+	// Release both pins from PWM once, like digitalWrite() would
+	timer = digitalPinToTimer(dataPin);
+	if (timer != NOT_ON_TIMER) turnOffPWM(timer);
+	timer = digitalPinToTimer(clockPin);
+	if (timer != NOT_ON_TIMER) turnOffPWM(timer);
+
+	volatile uint8_t *out = portOutputRegister(dataPort);
+	uint8_t dataMask = digitalPinToBitMask(dataPin);
+	uint8_t dataUnmask = ~dataMask;
+	volatile uint8_t *clk = portOutputRegister(clockPort);
+	uint8_t clockMask = digitalPinToBitMask(clockPin);
+	uint8_t clockUnmask = ~clockMask;
+
+#if defined(SHIFT_HAS_HARDWARE_SPI)
+	// Data changes while SCK is low and is taken on the rising edge, which
+	// is SPI mode 0. Once SPI is switched off again, MOSI and SCK fall back
+	// to their PORT bits, so those are set to what the bit-banged loop
+	// would have left behind: SCK low and MOSI at the last bit sent.
+	if (dataPin == PIN_SPI_MOSI && clockPin == PIN_SPI_SCK &&
+	    pinIsOutput(PIN_SPI_MOSI) && pinIsOutput(PIN_SPI_SCK) &&
+	    pinIsOutput(PIN_SPI_SS) && !pinIsOutput(PIN_SPI_MISO)) {
+		uint8_t spcr = _BV(SPE) | _BV(MSTR) | SHIFT_SPCR_CLOCK |
+			(bitOrder == LSBFIRST ? _BV(DORD) : 0);
+		uint8_t lastBit = bitOrder == LSBFIRST ? 0x80 : 0x01;
+		while (len--) {
+			uint8_t val = *buf++;
+			uint8_t oldSREG = SREG;
+			cli();
+			*clk &= clockUnmask;
+			if (val & lastBit) *out |= dataMask;
+			else *out &= dataUnmask;
+			shiftHardwareByte(spcr, val);
+			SREG = oldSREG;
 		}
-			
-		digitalWrite(clockPin, HIGH);
-		digitalWrite(clockPin, LOW);		
+		return;
+	}
+#endif
+
+#define SHIFT_OUT_BIT(b) \
+	if (val & (b)) *out |= dataMask; \
+	else *out &= dataUnmask; \
+	*clk |= clockMask; \
+	*clk &= clockUnmask;
+
+	while (len--) {
+		uint8_t val = *buf++;
+		if (bitOrder == LSBFIRST) val = reverseBits(val);
+
+		// Interrupts are only held off for one byte at a time, and the
+		// port read-modify-writes stay atomic like in digitalWrite()
+		uint8_t oldSREG = SREG;
+		cli();
+
+		SHIFT_OUT_BIT(0x80);
+		SHIFT_OUT_BIT(0x40);
+		SHIFT_OUT_BIT(0x20);
+		SHIFT_OUT_BIT(0x10);
+		SHIFT_OUT_BIT(0x08);
+		SHIFT_OUT_BIT(0x04);
+		SHIFT_OUT_BIT(0x02);
+		SHIFT_OUT_BIT(0x01);
+
+		SREG = oldSREG;
 	}
+
+#undef SHIFT_OUT_BIT
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
+{
+	shiftOutBuffer(dataPin, clockPin, bitOrder, &val, 1);
 }
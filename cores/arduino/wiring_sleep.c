@@ -0,0 +1,227 @@
+/*
+  wiring_sleep.c - sleep between events when the sketch is idle
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include "wiring_private.h"
+
+// main() calls idleSleepRun() through a weak reference, so this file
+// (and its watchdog interrupt) is only linked into sketches that call
+// loopIdle().
+//
+// The CPU sleeps in idle mode whenever something still needs the I/O
+// clock: a serial port with data still waiting to be sent, USB, SPI,
+// TWI, a running ADC conversion, PWM or other timer outputs and
+// interrupts, or an enabled external or pin change interrupt. Timer 0
+// keeps running in idle mode, so millis() stays exact and its overflow
+// wakes the CPU at least every millisecond or so. A serial port that is
+// only receiving does not keep the CPU in idle mode; bytes arriving
+// while it is powered down are lost.
+//
+// Otherwise it powers down and the watchdog, restarted from zero, wakes
+// it after one period. With pin interrupts ruled out nothing else can
+// wake it, so every power-down lasts exactly one watchdog period, which
+// is added to millis() and micros(). The watchdog oscillator is only
+// accurate to some percent and drifts with voltage and temperature, so
+// its period is measured against timer 0 before the first power-down
+// and again every IDLE_WDT_RECALIBRATE of them; until then the CPU
+// sleeps in idle mode. Sketches that use the watchdog themselves are
+// never powered down.
+
+// power-downs between two measurements of the watchdog period
+#define IDLE_WDT_RECALIBRATE 64
+
+// in HardwareSerial.cpp, which is only linked in when a serial port is used
+extern bool serialTxPending(void) __attribute__((weak));
+
+static bool idle_requested;
+static uint8_t idle_deepest = SLEEP_MODE_PWR_DOWN;
+
+#if defined(WDTCSR) && defined(WDIE)
+// what the watchdog interrupt is for, if it is ours
+#define WDT_UNUSED 0
+#define WDT_MEASURING 1
+#define WDT_SLEEPING 2
+static volatile uint8_t wdt_use;
+static unsigned long wdt_start_us;
+static unsigned long wdt_period_us;
+static uint8_t wdt_sleeps_left;         // until it is measured again
+#endif
+
+void loopIdle(void)
+{
+	idle_requested = true;
+}
+
+void setIdleSleepMode(uint8_t deepest)
+{
+	idle_deepest = deepest;
+}
+
+#if defined(WDTCSR) && defined(WDIE)
+// Starts the watchdog from zero, interrupt only, 16 ms. Called with
+// interrupts disabled.
+static void wdtStart(uint8_t use)
+{
+	wdt_use = use;
+	wdt_reset();
+	WDTCSR = _BV(WDCE) | _BV(WDE);
+	WDTCSR = _BV(WDIE);
+}
+
+// Called with interrupts disabled
+static void wdtStop(void)
+{
+	WDTCSR = _BV(WDCE) | _BV(WDE);
+	WDTCSR = 0;
+	wdt_use = WDT_UNUSED;
+}
+
+ISR(WDT_vect)
+{
+	if (wdt_use == WDT_MEASURING) {
+		// timer 0 ran all along, so micros() has the period
+		wdt_period_us = micros() - wdt_start_us;
+		wdt_sleeps_left = IDLE_WDT_RECALIBRATE;
+		wdtStop();
+	} else if (wdt_use == WDT_SLEEPING) {
+		timer0Advance(wdt_period_us);
+	}
+}
+#endif
+
+// true if some peripheral in use stops working without the I/O clock, or
+// an interrupt other than the watchdog could end a power-down early
+static bool needsIOClock(void)
+{
+	if (serialTxPending && serialTxPending()) return true;
+#if defined(USBCON)
+	if ((USBCON & _BV(USBE)) && !(USBCON & _BV(FRZCLK))) return true;
+#endif
+#if defined(SPCR)
+	if (SPCR & _BV(SPE)) return true;
+#endif
+#if defined(TWCR)
+	if (TWCR & _BV(TWEN)) return true;
+#endif
+#if defined(ADCSRA)
+	if (ADCSRA & _BV(ADSC)) return true;
+#endif
+
+	// compare outputs; the low two bits of TCCRnA are waveform bits
+#if defined(TCCR0A)
+	if (TCCR0A & 0xF0) return true;
+#endif
+#if defined(TCCR1A)
+	if (TCCR1A & 0xFC) return true;
+#endif
+#if defined(TCCR2A)
+	if (TCCR2A & 0xF0) return true;
+#endif
+#if defined(TCCR3A)
+	if (TCCR3A & 0xFC) return true;
+#endif
+#if defined(TCCR4A)
+	if (TCCR4A & 0xFC) return true;
+#endif
+#if defined(TCCR5A)
+	if (TCCR5A & 0xFC) return true;
+#endif
+
+	// timer interrupts besides the millis() overflow (tone, Servo, ...)
+#if defined(TIMSK0) && defined(TOIE0)
+	if (TIMSK0 & ~_BV(TOIE0)) return true;
+#endif
+#if defined(TIMSK1)
+	if (TIMSK1) return true;
+#endif
+#if defined(TIMSK2)
+	if (TIMSK2) return true;
+#endif
+#if defined(TIMSK3)
+	if (TIMSK3) return true;
+#endif
+#if defined(TIMSK4)
+	if (TIMSK4) return true;
+#endif
+#if defined(TIMSK5)
+	if (TIMSK5) return true;
+#endif
+
+	// pin interrupts wake the CPU at a time the watchdog cannot tell
+#if defined(EIMSK)
+	if (EIMSK) return true;
+#endif
+#if defined(PCICR)
+	if (PCICR) return true;
+#endif
+
+	return false;
+}
+
+void idleSleepRun(void)
+{
+	if (!idle_requested)
+		return;
+	idle_requested = false;
+
+	uint8_t mode = SLEEP_MODE_IDLE;
+#if defined(WDTCSR) && defined(WDIE)
+	if (idle_deepest != SLEEP_MODE_IDLE && wdt_use == WDT_UNUSED &&
+	    !(WDTCSR & (_BV(WDE) | _BV(WDIE))) && !needsIOClock()) {
+		if (wdt_sleeps_left) {
+			mode = idle_deepest;
+		} else {
+			// measure the watchdog period first, sleeping in idle mode
+			// meanwhile; the watchdog interrupt ends the measurement
+			cli();
+			wdt_start_us = micros();
+			wdtStart(WDT_MEASURING);
+			sei();
+		}
+	}
+#endif
+
+	cli();
+	// an interrupt may have posted an event after runEvents() returned
+	if (eventsPending && eventsPending()) {
+		sei();
+		return;
+	}
+	set_sleep_mode(mode);
+#if defined(WDTCSR) && defined(WDIE)
+	if (mode != SLEEP_MODE_IDLE)
+		wdtStart(WDT_SLEEPING);
+#endif
+	sleep_enable();
+	// the instruction after sei is executed before any interrupt, so one
+	// arriving here still wakes the CPU instead of being missed
+	sei();
+	sleep_cpu();
+	sleep_disable();
+#if defined(WDTCSR) && defined(WDIE)
+	if (mode != SLEEP_MODE_IDLE) {
+		cli();
+		wdtStop();
+		wdt_sleeps_left--;
+		sei();
+	}
+#endif
+}
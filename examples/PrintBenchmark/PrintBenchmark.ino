@@ -0,0 +1,127 @@
+/*
+  Print Benchmark
+
+  Times print(unsigned long) against the generic digit loop it replaced,
+  which runs a 32-bit % and / per digit. Both print into a Print that
+  only keeps the characters, so what is measured is the conversion, not
+  a serial port. Timer 1 runs at the CPU clock and interrupts are off
+  while a value is printed, so the figures are CPU cycles.
+
+  For every value the sketch prints the cycles taken by the old and the
+  new code, and checks that both produced the same text.
+
+  Timer 1 is taken over, so analogWrite() on its pins (9 and 10 on an
+  Uno) does not work while this runs.
+*/
+
+// Collects what is printed, so that it can be compared
+class BufferPrint : public Print {
+  public:
+    char text[12];
+    uint8_t length;
+
+    BufferPrint() : length(0) {}
+
+    virtual size_t write(uint8_t c) {
+      if (length < sizeof(text) - 1) {
+        text[length++] = c;
+        text[length] = '\0';
+      }
+      return 1;
+    }
+
+    void clear() {
+      length = 0;
+      text[0] = '\0';
+    }
+};
+
+// Print::printNumber() as it was before the base 10 fast path
+size_t oldPrintNumber(Print &p, unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+
+  *str = '\0';
+
+  if (base < 2) base = 10;
+
+  do {
+    char c = n % base;
+    n /= base;
+
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+
+  return p.write(str);
+}
+
+const unsigned long values[] = {
+  0, 7, 42, 255, 1000, 65535, 65536, 123456, 9999999, 1234567890,
+  4294967295UL
+};
+
+BufferPrint oldOut, newOut;
+
+uint16_t timeOld(unsigned long n) {
+  oldOut.clear();
+  noInterrupts();
+  TCNT1 = 0;
+  oldPrintNumber(oldOut, n, 10);
+  uint16_t cycles = TCNT1;
+  interrupts();
+  return cycles;
+}
+
+uint16_t timeNew(unsigned long n) {
+  newOut.clear();
+  noInterrupts();
+  TCNT1 = 0;
+  newOut.print(n);
+  uint16_t cycles = TCNT1;
+  interrupts();
+  return cycles;
+}
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial) {
+    ; // wait for serial port to connect. Needed for native USB port only
+  }
+
+  // normal mode, no prescaler: TCNT1 counts CPU cycles
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+
+  // the time to read TCNT1 back, taken off every figure
+  noInterrupts();
+  TCNT1 = 0;
+  uint16_t overhead = TCNT1;
+  interrupts();
+
+  Serial.println(F("value\told\tnew"));
+  unsigned long oldTotal = 0, newTotal = 0;
+  for (uint8_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    uint16_t oldCycles = timeOld(values[i]) - overhead;
+    uint16_t newCycles = timeNew(values[i]) - overhead;
+    oldTotal += oldCycles;
+    newTotal += newCycles;
+
+    Serial.print(values[i]);
+    Serial.print('\t');
+    Serial.print(oldCycles);
+    Serial.print('\t');
+    Serial.print(newCycles);
+    if (strcmp(oldOut.text, newOut.text) != 0) {
+      Serial.print(F("\tMISMATCH "));
+      Serial.print(newOut.text);
+    }
+    Serial.println();
+  }
+  Serial.print(F("total\t"));
+  Serial.print(oldTotal);
+  Serial.print('\t');
+  Serial.println(newTotal);
+}
+
+void loop() {
+}
@@ -0,0 +1,147 @@
+/*
+  String Benchmark
+
+  Measures how String copes with being built up a piece at a time, as
+  Stream::readString() does: the time taken, and the state of the heap
+  afterwards. Each workload is run twice, once growing the buffer to the
+  exact length before every append, which is what String did before its
+  growth became amortised, and once with plain appends.
+
+  Workloads:
+   - one String, 200 single characters appended
+   - four Strings, 50 characters appended to each in turn, as when
+     several fields are read side by side
+   - one String, 40 five character pieces appended, with a short lived
+     String allocated in between, as when values are formatted into it
+
+  For every run the sketch prints the time in microseconds, the number of
+  reallocations seen (a change of the buffer address), the size of the
+  heap, and the number and total size of the free blocks left inside it
+  together with the largest one. Free blocks inside the heap that are too
+  small for the next request are fragmentation.
+*/
+
+// avr-libc's list of free blocks below the top of the heap
+struct __freelist {
+  size_t sz;
+  struct __freelist *nx;
+};
+extern struct __freelist *__flp;
+extern char __heap_start;
+extern char *__brkval;
+
+struct HeapStats {
+  size_t size;          // from the start of the heap to its top
+  uint8_t freeBlocks;
+  size_t freeBytes;
+  size_t largestFree;
+};
+
+void readHeap(HeapStats &stats) {
+  char *top = __brkval ? __brkval : &__heap_start;
+  stats.size = top - &__heap_start;
+  stats.freeBlocks = 0;
+  stats.freeBytes = 0;
+  stats.largestFree = 0;
+  for (struct __freelist *fp = __flp; fp; fp = fp->nx) {
+    stats.freeBlocks++;
+    stats.freeBytes += fp->sz;
+    if (fp->sz > stats.largestFree) stats.largestFree = fp->sz;
+  }
+}
+
+bool exactGrowth;
+uint16_t reallocations;
+
+// Appends text, reserving exactly the new length first when exactGrowth
+// is set, and counts the times the buffer moves
+void append(String &s, const char *text) {
+  const char *before = s.c_str();
+  if (exactGrowth) s.reserve(s.length() + strlen(text));
+  s += text;
+  if (s.c_str() != before) reallocations++;
+}
+
+void report(const __FlashStringHelper *name, unsigned long micros) {
+  HeapStats stats;
+  readHeap(stats);
+  Serial.print(name);
+  Serial.print(exactGrowth ? F("\texact\t") : F("\tamortised\t"));
+  Serial.print(micros);
+  Serial.print('\t');
+  Serial.print(reallocations);
+  Serial.print('\t');
+  Serial.print(stats.size);
+  Serial.print('\t');
+  Serial.print(stats.freeBlocks);
+  Serial.print('\t');
+  Serial.print(stats.freeBytes);
+  Serial.print('\t');
+  Serial.println(stats.largestFree);
+}
+
+void singleString() {
+  String s;
+  unsigned long start = micros();
+  for (uint8_t i = 0; i < 200; i++) {
+    char c[2] = { (char)('a' + i % 26), '\0' };
+    append(s, c);
+  }
+  report(F("single"), micros() - start);
+}
+
+void interleaved() {
+  String fields[4];
+  unsigned long start = micros();
+  for (uint8_t i = 0; i < 50; i++) {
+    for (uint8_t f = 0; f < 4; f++) {
+      char c[2] = { (char)('0' + f), '\0' };
+      append(fields[f], c);
+    }
+  }
+  report(F("interleaved"), micros() - start);
+}
+
+void withTemporaries() {
+  String s;
+  unsigned long start = micros();
+  for (uint8_t i = 0; i < 40; i++) {
+    String value(i * 1000L + 10000L);
+    append(s, value.c_str());
+  }
+  report(F("temporaries"), micros() - start);
+}
+
+void run(bool exact) {
+  exactGrowth = exact;
+
+  reallocations = 0;
+  singleString();
+  reallocations = 0;
+  interleaved();
+  reallocations = 0;
+  withTemporaries();
+}
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial) {
+    ; // wait for serial port to connect. Needed for native USB port only
+  }
+
+  Serial.println(F("workload\tgrowth\tus\treallocs\theap\tfree blocks\tfree bytes\tlargest free"));
+  run(true);
+  run(false);
+
+  // Everything has been freed again, so the heap should be back to empty
+  HeapStats stats;
+  readHeap(stats);
+  Serial.print(F("heap after the runs: "));
+  Serial.print(stats.size);
+  Serial.print(F(" bytes, "));
+  Serial.print(stats.freeBlocks);
+  Serial.println(F(" free blocks"));
+}
+
+void loop() {
+}
@@ -22,6 +22,10 @@ uint8_t SPIClass::interruptSave = 0;
 #ifdef SPI_TRANSACTION_MISMATCH_LED
 uint8_t SPIClass::inTransactionFlag = 0;
 #endif
+// The rest of the asynchronous transfer state is in SPIAsync.cpp
+volatile uint8_t SPIClass::asyncHead = 0;
+volatile uint8_t SPIClass::asyncTail = 0;
+void (*SPIClass::asyncWait)(void) = NULL;
 
 void SPIClass::begin()
 {
@@ -64,6 +68,7 @@ void SPIClass::begin()
 }
 
 void SPIClass::end() {
+  flushAsync();
   uint8_t sreg = SREG;
   noInterrupts(); // Protect from a scheduler and prevent transactionBegin
   // Decrease the reference counter
@@ -117,40 +122,47 @@ void SPIClass::end() {
   #endif
 #endif
 
-void SPIClass::usingInterrupt(uint8_t interruptNumber)
+// Bit within SPI_AVR_EIMSK for an interrupt number as used with
+// attachInterrupt(), or 0 if it cannot be masked on its own
+uint8_t SPIClass::interruptNumberMask(uint8_t interruptNumber)
 {
-  uint8_t mask = 0;
-  uint8_t sreg = SREG;
-  noInterrupts(); // Protect from a scheduler and prevent transactionBegin
   switch (interruptNumber) {
   #ifdef SPI_INT0_MASK
-  case 0: mask = SPI_INT0_MASK; break;
+  case 0: return SPI_INT0_MASK;
   #endif
   #ifdef SPI_INT1_MASK
-  case 1: mask = SPI_INT1_MASK; break;
+  case 1: return SPI_INT1_MASK;
   #endif
   #ifdef SPI_INT2_MASK
-  case 2: mask = SPI_INT2_MASK; break;
+  case 2: return SPI_INT2_MASK;
   #endif
   #ifdef SPI_INT3_MASK
-  case 3: mask = SPI_INT3_MASK; break;
+  case 3: return SPI_INT3_MASK;
   #endif
   #ifdef SPI_INT4_MASK
-  case 4: mask = SPI_INT4_MASK; break;
+  case 4: return SPI_INT4_MASK;
   #endif
   #ifdef SPI_INT5_MASK
-  case 5: mask = SPI_INT5_MASK; break;
+  case 5: return SPI_INT5_MASK;
   #endif
   #ifdef SPI_INT6_MASK
-  case 6: mask = SPI_INT6_MASK; break;
+  case 6: return SPI_INT6_MASK;
   #endif
   #ifdef SPI_INT7_MASK
-  case 7: mask = SPI_INT7_MASK; break;
+  case 7: return SPI_INT7_MASK;
   #endif
   default:
-    interruptMode = 2;
-    break;
+    return 0;
   }
+}
+
+void SPIClass::usingInterrupt(uint8_t interruptNumber)
+{
+  uint8_t sreg = SREG;
+  noInterrupts(); // Protect from a scheduler and prevent transactionBegin
+  uint8_t mask = interruptNumberMask(interruptNumber);
+  if (!mask)
+    interruptMode = 2;
   interruptMask |= mask;
   if (!interruptMode)
     interruptMode = 1;
@@ -162,40 +174,89 @@ void SPIClass::notUsingInterrupt(uint8_t interruptNumber)
   // Once in mode 2 we can't go back to 0 without a proper reference count
   if (interruptMode == 2)
     return;
-  uint8_t mask = 0;
   uint8_t sreg = SREG;
   noInterrupts(); // Protect from a scheduler and prevent transactionBegin
-  switch (interruptNumber) {
-  #ifdef SPI_INT0_MASK
-  case 0: mask = SPI_INT0_MASK; break;
-  #endif
-  #ifdef SPI_INT1_MASK
-  case 1: mask = SPI_INT1_MASK; break;
-  #endif
-  #ifdef SPI_INT2_MASK
-  case 2: mask = SPI_INT2_MASK; break;
-  #endif
-  #ifdef SPI_INT3_MASK
-  case 3: mask = SPI_INT3_MASK; break;
-  #endif
-  #ifdef SPI_INT4_MASK
-  case 4: mask = SPI_INT4_MASK; break;
-  #endif
-  #ifdef SPI_INT5_MASK
-  case 5: mask = SPI_INT5_MASK; break;
-  #endif
-  #ifdef SPI_INT6_MASK
-  case 6: mask = SPI_INT6_MASK; break;
-  #endif
-  #ifdef SPI_INT7_MASK
-  case 7: mask = SPI_INT7_MASK; break;
-  #endif
-  default:
-    break;
-    // this case can't be reached
-  }
-  interruptMask &= ~mask;
+  interruptMask &= ~interruptNumberMask(interruptNumber);
   if (!interruptMask)
     interruptMode = 0;
   SREG = sreg;
 }
+
+// In the loops below the next byte is fetched before waiting for SPIF, so
+// that SPDR is written again as soon as possible. SPIF is cleared by
+// reading SPSR and then accessing SPDR, so the write-only loops leave it
+// set for a single dummy read at the end.
+
+void SPIClass::transfer(const void *txbuf, void *rxbuf, size_t count)
+{
+  if (!rxbuf) {
+    if (txbuf)
+      write(txbuf, count);
+    else
+      fill(0xFF, count);
+    return;
+  }
+  if (count == 0) return;
+  const uint8_t *tx = (const uint8_t *)txbuf;
+  uint8_t *rx = (uint8_t *)rxbuf;
+  if (tx) {
+    SPDR = *tx++;
+    while (--count > 0) {
+      uint8_t out = *tx++;
+      while (!(SPSR & _BV(SPIF))) ;
+      uint8_t in = SPDR;
+      SPDR = out;
+      *rx++ = in;
+    }
+  } else {
+    SPDR = 0xFF;
+    while (--count > 0) {
+      while (!(SPSR & _BV(SPIF))) ;
+      uint8_t in = SPDR;
+      SPDR = 0xFF;
+      *rx++ = in;
+    }
+  }
+  while (!(SPSR & _BV(SPIF))) ;
+  *rx = SPDR;
+}
+
+void SPIClass::write(const void *buf, size_t count)
+{
+  if (count == 0) return;
+  const uint8_t *p = (const uint8_t *)buf;
+  SPDR = *p++;
+  while (--count > 0) {
+    uint8_t out = *p++;
+    while (!(SPSR & _BV(SPIF))) ;
+    SPDR = out;
+  }
+  while (!(SPSR & _BV(SPIF))) ;
+  (void)SPDR;
+}
+
+void SPIClass::write_P(const void *buf, size_t count)
+{
+  if (count == 0) return;
+  const uint8_t *p = (const uint8_t *)buf;
+  SPDR = pgm_read_byte(p++);
+  while (--count > 0) {
+    uint8_t out = pgm_read_byte(p++);
+    while (!(SPSR & _BV(SPIF))) ;
+    SPDR = out;
+  }
+  while (!(SPSR & _BV(SPIF))) ;
+  (void)SPDR;
+}
+
+void SPIClass::fill(uint8_t value, size_t count)
+{
+  if (count == 0) return;
+  SPDR = value;
+  while (--count > 0) {
+    while (!(SPSR & _BV(SPIF))) ;
+    SPDR = value;
+  }
+  while (!(SPSR & _BV(SPIF))) ;
+  (void)SPDR;
+}
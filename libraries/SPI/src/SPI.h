@@ -56,6 +56,14 @@
 #define SPI_MODE2 0x08
 #define SPI_MODE3 0x0C
 
+// Number of transfers transferAsync() can queue (a power of two)
+#ifndef SPI_ASYNC_QUEUE_SIZE
+#define SPI_ASYNC_QUEUE_SIZE 4
+#endif
+
+// csPin value for asynchronous transfers without a chip select
+#define SPI_NO_CS 0xFF
+
 #define SPI_MODE_MASK 0x0C  // CPOL = bit 3, CPHA = bit 2 on SPCR
 #define SPI_CLOCK_MASK 0x03  // SPR1 = bit 1, SPR0 = bit 0 on SPCR
 #define SPI_2XCLOCK_MASK 0x01  // SPI2X = bit 0 on SPSR
@@ -150,9 +158,14 @@ private:
   uint8_t spcr;
   uint8_t spsr;
   friend class SPIClass;
+  friend class USARTSPIClass;
+  friend class SPIDevice;
 };
 
 
+// Called from the SPI interrupt when an asynchronous transfer completes
+typedef void (*SPIAsyncCallback)(void);
+
 class SPIClass {
 public:
   // Initialize the SPI library
@@ -176,30 +189,7 @@ public:
   // this function is used to gain exclusive access to the SPI bus
   // and configure the correct settings.
   inline static void beginTransaction(SPISettings settings) {
-    if (interruptMode > 0) {
-      uint8_t sreg = SREG;
-      noInterrupts();
-
-      #ifdef SPI_AVR_EIMSK
-      if (interruptMode == 1) {
-        interruptSave = SPI_AVR_EIMSK;
-        SPI_AVR_EIMSK &= ~interruptMask;
-        SREG = sreg;
-      } else
-      #endif
-      {
-        interruptSave = sreg;
-      }
-    }
-
-    #ifdef SPI_TRANSACTION_MISMATCH_LED
-    if (inTransactionFlag) {
-      pinMode(SPI_TRANSACTION_MISMATCH_LED, OUTPUT);
-      digitalWrite(SPI_TRANSACTION_MISMATCH_LED, HIGH);
-    }
-    inTransactionFlag = 1;
-    #endif
-
+    lockBus();
     SPCR = settings.spcr;
     SPSR = settings.spsr;
   }
@@ -255,32 +245,52 @@ public:
     while (!(SPSR & _BV(SPIF))) ;
     *p = SPDR;
   }
+  // Send count bytes from txbuf and store the bytes received in rxbuf,
+  // which may be the same buffer. txbuf may be NULL to send 0xFF bytes and
+  // rxbuf NULL to discard what is received.
+  static void transfer(const void *txbuf, void *rxbuf, size_t count);
+  // Send count bytes and ignore what is received. The next byte is loaded
+  // while the current one shifts out, so at fosc/2 the bus is idle only
+  // for the few cycles between SPIF and the write of SPDR.
+  static void write(const void *buf, size_t count);
+  // write() for data in flash (PROGMEM)
+  static void write_P(const void *buf, size_t count);
+  // Send count copies of value, e.g. to clear a display
+  static void fill(uint8_t value, size_t count);
+
+  // Queue a transfer of count bytes that runs from the SPI interrupt while
+  // the sketch goes on. txbuf may be NULL to send 0xFF bytes and rxbuf
+  // NULL to discard what is received; both must stay valid until callback
+  // (which may be NULL) is called, from the interrupt. csPin, unless
+  // SPI_NO_CS, is driven LOW for the transfer and HIGH after it and must
+  // already be an OUTPUT. Transfers run one after another in order, each
+  // with its own settings, inside a transaction of their own, so call this
+  // outside of beginTransaction()/endTransaction(); beginTransaction()
+  // waits for queued transfers to finish. Returns false if the queue is
+  // full.
+  //
+  // Each byte costs an interrupt, so this frees the CPU at SPI clocks of
+  // fosc/8 and below; at fosc/2 and fosc/4 it is no faster than
+  // transfer(). If usingInterrupt() was called with an interrupt that
+  // cannot be masked on its own, the transfer runs at once, blocking.
+  static bool transferAsync(SPISettings settings, uint8_t csPin,
+                            const void *txbuf, void *rxbuf, size_t count,
+                            SPIAsyncCallback callback);
+  // true while asynchronous transfers are queued or running
+  inline static bool asyncBusy(void) { return asyncHead != asyncTail; }
+  // wait for all queued asynchronous transfers to complete
+  inline static void flushAsync(void) {
+    if (asyncHead != asyncTail)
+      asyncWait();
+  }
+  // Advances the current asynchronous transfer; called from the SPI
+  // interrupt, and by flushAsync() while interrupts are disabled
+  static void asyncStep(void);
+
   // After performing a group of transfers and releasing the chip select
   // signal, this function allows others to access the SPI bus
   inline static void endTransaction(void) {
-    #ifdef SPI_TRANSACTION_MISMATCH_LED
-    if (!inTransactionFlag) {
-      pinMode(SPI_TRANSACTION_MISMATCH_LED, OUTPUT);
-      digitalWrite(SPI_TRANSACTION_MISMATCH_LED, HIGH);
-    }
-    inTransactionFlag = 0;
-    #endif
-
-    if (interruptMode > 0) {
-      #ifdef SPI_AVR_EIMSK
-      uint8_t sreg = SREG;
-      #endif
-      noInterrupts();
-      #ifdef SPI_AVR_EIMSK
-      if (interruptMode == 1) {
-        SPI_AVR_EIMSK = interruptSave;
-        SREG = sreg;
-      } else
-      #endif
-      {
-        SREG = interruptSave;
-      }
-    }
+    unlockBus();
   }
 
   // Disable the SPI bus
@@ -310,6 +320,68 @@ public:
   inline static void detachInterrupt() { SPCR &= ~_BV(SPIE); }
 
 private:
+  friend class USARTSPIClass;
+  friend class SPIDevice;
+
+  // Gains exclusive access to the bus as beginTransaction() does, without
+  // touching the settings
+  inline static void lockBus(void) {
+    // the bus belongs to queued asynchronous transfers until they finish
+    flushAsync();
+
+    if (interruptMode > 0) {
+      uint8_t sreg = SREG;
+      noInterrupts();
+
+      #ifdef SPI_AVR_EIMSK
+      if (interruptMode == 1) {
+        interruptSave = SPI_AVR_EIMSK;
+        SPI_AVR_EIMSK &= ~interruptMask;
+        SREG = sreg;
+      } else
+      #endif
+      {
+        interruptSave = sreg;
+      }
+    }
+
+    #ifdef SPI_TRANSACTION_MISMATCH_LED
+    if (inTransactionFlag) {
+      pinMode(SPI_TRANSACTION_MISMATCH_LED, OUTPUT);
+      digitalWrite(SPI_TRANSACTION_MISMATCH_LED, HIGH);
+    }
+    inTransactionFlag = 1;
+    #endif
+  }
+  // The counterpart of lockBus()
+  inline static void unlockBus(void) {
+    #ifdef SPI_TRANSACTION_MISMATCH_LED
+    if (!inTransactionFlag) {
+      pinMode(SPI_TRANSACTION_MISMATCH_LED, OUTPUT);
+      digitalWrite(SPI_TRANSACTION_MISMATCH_LED, HIGH);
+    }
+    inTransactionFlag = 0;
+    #endif
+
+    if (interruptMode > 0) {
+      #ifdef SPI_AVR_EIMSK
+      uint8_t sreg = SREG;
+      #endif
+      noInterrupts();
+      #ifdef SPI_AVR_EIMSK
+      if (interruptMode == 1) {
+        SPI_AVR_EIMSK = interruptSave;
+        SREG = sreg;
+      } else
+      #endif
+      {
+        SREG = interruptSave;
+      }
+    }
+  }
+
+  static uint8_t interruptNumberMask(uint8_t interruptNumber);
+
   static uint8_t initialized;
   static uint8_t interruptMode; // 0=none, 1=mask, 2=global
   static uint8_t interruptMask; // which interrupts to mask
@@ -317,6 +389,33 @@ private:
   #ifdef SPI_TRANSACTION_MISMATCH_LED
   static uint8_t inTransactionFlag;
   #endif
+
+  struct AsyncTransfer {
+    const uint8_t *tx;
+    uint8_t *rx;
+    size_t count;
+    SPIAsyncCallback callback;
+    volatile uint8_t *csOut; // NULL without chip select
+    uint8_t csMask;
+    uint8_t spcr;
+    uint8_t spsr;
+  };
+  // transferAsync() with chip select already resolved to a port and bit
+  // (csOut NULL for none), as SPIDevice has it
+  static bool queueAsync(SPISettings settings,
+                         volatile uint8_t *csOut, uint8_t csMask,
+                         const void *txbuf, void *rxbuf, size_t count,
+                         SPIAsyncCallback callback);
+  static void startAsync(void);
+  static void waitAsync(void);
+  // waitAsync() once transferAsync() has been called. Going through a
+  // pointer keeps SPIAsync.cpp, with its queue and interrupt, out of
+  // sketches that never queue a transfer.
+  static void (*asyncWait)(void);
+  static AsyncTransfer asyncQueue[SPI_ASYNC_QUEUE_SIZE];
+  static volatile uint8_t asyncHead;
+  static volatile uint8_t asyncTail;
+  static size_t asyncPos; // bytes of the current transfer sent so far
 };
 
 extern SPIClass SPI;
@@ -0,0 +1,165 @@
+/*
+ * Asynchronous transfers for the SPI library.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 2
+ * or the GNU Lesser General Public License version 2.1, both as
+ * published by the Free Software Foundation.
+ */
+
+// Kept apart from SPI.cpp, so that the queue and the SPI interrupt are
+// only linked into sketches that call transferAsync(). The rest of the
+// library reaches this file only through the asyncWait pointer, which
+// transferAsync() sets.
+
+#include "SPI.h"
+
+SPIClass::AsyncTransfer SPIClass::asyncQueue[SPI_ASYNC_QUEUE_SIZE];
+size_t SPIClass::asyncPos = 0;
+
+#if (SPI_ASYNC_QUEUE_SIZE & (SPI_ASYNC_QUEUE_SIZE - 1)) || SPI_ASYNC_QUEUE_SIZE > 128
+#error SPI_ASYNC_QUEUE_SIZE must be a power of two no larger than 128
+#endif
+
+// Asynchronous transfers. asyncQueue is a ring indexed by the free running
+// asyncHead (written by transferAsync()) and asyncTail (advanced by the
+// interrupt when a transfer completes); the transfer at asyncTail is the
+// one on the bus. The transaction is begun when the queue goes from empty
+// to busy and ended when it drains, so interrupts registered with
+// usingInterrupt() stay masked in between.
+
+bool SPIClass::transferAsync(SPISettings settings, uint8_t csPin,
+                             const void *txbuf, void *rxbuf, size_t count,
+                             SPIAsyncCallback callback)
+{
+  volatile uint8_t *csOut = NULL;
+  uint8_t csMask = 0;
+  if (csPin != SPI_NO_CS) {
+    uint8_t port = digitalPinToPort(csPin);
+    if (port != NOT_A_PIN) {
+      csOut = portOutputRegister(port);
+      csMask = digitalPinToBitMask(csPin);
+    }
+  }
+  return queueAsync(settings, csOut, csMask, txbuf, rxbuf, count, callback);
+}
+
+bool SPIClass::queueAsync(SPISettings settings,
+                          volatile uint8_t *csOut, uint8_t csMask,
+                          const void *txbuf, void *rxbuf, size_t count,
+                          SPIAsyncCallback callback)
+{
+  // the SPI interrupt could not run inside such a transaction
+  if (interruptMode == 2 || count == 0) {
+    if (count) {
+      beginTransaction(settings);
+      if (csOut) *csOut &= ~csMask;
+      const uint8_t *tx = (const uint8_t *)txbuf;
+      uint8_t *rx = (uint8_t *)rxbuf;
+      for (size_t i = 0; i < count; i++) {
+        uint8_t in = transfer(tx ? tx[i] : 0xFF);
+        if (rx) rx[i] = in;
+      }
+      if (csOut) *csOut |= csMask;
+      endTransaction();
+    }
+    if (callback) callback();
+    return true;
+  }
+
+  asyncWait = waitAsync;
+
+  uint8_t sreg = SREG;
+  noInterrupts();
+  uint8_t head = asyncHead;
+  if ((uint8_t)(head - asyncTail) >= SPI_ASYNC_QUEUE_SIZE) {
+    SREG = sreg;
+    return false;
+  }
+  AsyncTransfer &t = asyncQueue[head & (SPI_ASYNC_QUEUE_SIZE - 1)];
+  t.tx = (const uint8_t *)txbuf;
+  t.rx = (uint8_t *)rxbuf;
+  t.count = count;
+  t.callback = callback;
+  t.csOut = csOut;
+  t.csMask = csMask;
+  t.spcr = settings.spcr;
+  t.spsr = settings.spsr;
+  asyncHead = head + 1;
+  if (head == asyncTail) {
+    // nothing was queued, so take the bus and start right away
+    #ifdef SPI_AVR_EIMSK
+    if (interruptMode == 1) {
+      interruptSave = SPI_AVR_EIMSK;
+      SPI_AVR_EIMSK &= ~interruptMask;
+    }
+    #endif
+    startAsync();
+  }
+  SREG = sreg;
+  return true;
+}
+
+// Sets up the transfer at asyncTail and sends its first byte. Called with
+// interrupts disabled.
+void SPIClass::startAsync(void)
+{
+  AsyncTransfer &t = asyncQueue[asyncTail & (SPI_ASYNC_QUEUE_SIZE - 1)];
+  SPCR = t.spcr;
+  SPSR = t.spsr;
+  // reading SPSR and then SPDR clears a leftover SPIF, which would
+  // otherwise raise the interrupt at once
+  (void)SPSR;
+  (void)SPDR;
+  SPCR = t.spcr | _BV(SPIE);
+  if (t.csOut) *t.csOut &= ~t.csMask;
+  asyncPos = 0;
+  SPDR = t.tx ? t.tx[0] : 0xFF;
+}
+
+void SPIClass::asyncStep(void)
+{
+  AsyncTransfer &t = asyncQueue[asyncTail & (SPI_ASYNC_QUEUE_SIZE - 1)];
+  uint8_t in = SPDR;
+  size_t pos = asyncPos;
+  // keep the bus busy before storing what came in
+  if (pos + 1 < t.count)
+    SPDR = t.tx ? t.tx[pos + 1] : 0xFF;
+  if (t.rx) t.rx[pos] = in;
+  asyncPos = ++pos;
+  if (pos < t.count)
+    return;
+
+  if (t.csOut) *t.csOut |= t.csMask;
+  SPIAsyncCallback callback = t.callback;
+  asyncTail++;
+  if (asyncTail != asyncHead) {
+    startAsync();
+  } else {
+    SPCR &= ~_BV(SPIE);
+    #ifdef SPI_AVR_EIMSK
+    if (interruptMode == 1)
+      SPI_AVR_EIMSK = interruptSave;
+    #endif
+  }
+  if (callback) callback();
+}
+
+// Waits for the queue to drain; called through asyncWait by flushAsync()
+void SPIClass::waitAsync(void)
+{
+  while (asyncHead != asyncTail) {
+    // with interrupts disabled (e.g. called from an interrupt) the
+    // transfers have to be driven from here
+    if (!(SREG & _BV(SREG_I)) && (SPSR & _BV(SPIF)))
+      asyncStep();
+  }
+}
+
+// Weak, so that sketches and libraries using the SPI interrupt for
+// something else (e.g. as a slave) can still define it; transferAsync()
+// cannot be used then.
+ISR(SPI_STC_vect, __attribute__((weak)))
+{
+  SPIClass::asyncStep();
+}
@@ -0,0 +1,47 @@
+/*
+ * SPI device handle with cached settings and chip select for arduino.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 2
+ * or the GNU Lesser General Public License version 2.1, both as
+ * published by the Free Software Foundation.
+ */
+
+#include "SPIDevice.h"
+
+void SPIDevice::begin()
+{
+  SPIClass::begin();
+  if (csPin != SPI_NO_CS) {
+    uint8_t port = digitalPinToPort(csPin);
+    if (port != NOT_A_PIN) {
+      // HIGH before OUTPUT, so the device is never selected by accident
+      digitalWrite(csPin, HIGH);
+      pinMode(csPin, OUTPUT);
+      csOut = portOutputRegister(port);
+      csMask = digitalPinToBitMask(csPin);
+    }
+  }
+}
+
+void SPIDevice::end()
+{
+  SPIClass::end();
+}
+
+void SPIDevice::transfer(const SPITransfer *list, uint8_t count)
+{
+  beginTransaction();
+  for (uint8_t i = 0; i < count; i++) {
+    const SPITransfer &t = list[i];
+    if (t.flags & SPI_TRANSFER_PROGMEM)
+      SPIClass::write_P(t.tx, t.count);
+    else
+      SPIClass::transfer(t.tx, t.rx, t.count);
+    if ((t.flags & SPI_TRANSFER_DESELECT) && i + 1 < count) {
+      deselect();
+      select();
+    }
+  }
+  endTransaction();
+}
@@ -0,0 +1,99 @@
+/*
+ * SPI device handle with cached settings and chip select for arduino.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 2
+ * or the GNU Lesser General Public License version 2.1, both as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _SPIDEVICE_H_INCLUDED
+#define _SPIDEVICE_H_INCLUDED
+
+#include "SPI.h"
+
+// Flags for SPITransfer entries
+#define SPI_TRANSFER_DESELECT 0x01 // raise chip select after this entry
+#define SPI_TRANSFER_PROGMEM  0x02 // tx points to flash (rx must be NULL)
+
+// One entry of a batch for SPIDevice::transfer(). tx may be NULL to send
+// 0xFF bytes and rx NULL to discard what is received.
+struct SPITransfer {
+  const void *tx;
+  void *rx;
+  size_t count;
+  uint8_t flags;
+};
+
+// A device on the SPI bus: its settings, computed once, and its chip
+// select pin, resolved once by begin() to a port register and bit, which
+// transactions and asynchronous transfers drive directly instead of
+// through digitalWrite(). Bus locking (usingInterrupt(), asynchronous
+// transfers) is the same as with SPI.beginTransaction().
+//
+//   SPIDevice flash(10, SPISettings(8000000, MSBFIRST, SPI_MODE0));
+//   flash.begin();
+//   flash.beginTransaction();
+//   SPI.transfer(0x9F);
+//   ...
+//   flash.endTransaction();
+class SPIDevice {
+public:
+  // csPin may be SPI_NO_CS for a device without chip select
+  SPIDevice(uint8_t csPin, SPISettings settings) :
+    settings(settings), csPin(csPin), csOut(NULL), csMask(0) {}
+
+  // calls SPI.begin() and makes chip select an output, HIGH
+  void begin();
+  // calls SPI.end()
+  void end();
+
+  // locks the bus, applies the settings and selects the device
+  inline void beginTransaction(void) {
+    SPIClass::lockBus();
+    SPCR = settings.spcr;
+    SPSR = settings.spsr;
+    select();
+  }
+  // deselects the device and releases the bus
+  inline void endTransaction(void) {
+    deselect();
+    SPIClass::unlockBus();
+  }
+
+  // Chip select on its own, e.g. to end a command within a transaction.
+  // Interrupts are blocked for the read-modify-write of the port.
+  inline void select(void) {
+    if (csOut) {
+      uint8_t sreg = SREG;
+      noInterrupts();
+      *csOut &= ~csMask;
+      SREG = sreg;
+    }
+  }
+  inline void deselect(void) {
+    if (csOut) {
+      uint8_t sreg = SREG;
+      noInterrupts();
+      *csOut |= csMask;
+      SREG = sreg;
+    }
+  }
+
+  // Runs count entries in a single transaction
+  void transfer(const SPITransfer *list, uint8_t count);
+
+  // SPI.transferAsync() with this device's settings and chip select
+  bool transferAsync(const void *txbuf, void *rxbuf, size_t count,
+                     SPIAsyncCallback callback) {
+    return SPIClass::queueAsync(settings, csOut, csMask, txbuf, rxbuf, count, callback);
+  }
+
+private:
+  SPISettings settings;
+  uint8_t csPin;
+  volatile uint8_t *csOut;
+  uint8_t csMask;
+};
+
+#endif
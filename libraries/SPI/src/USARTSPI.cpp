@@ -0,0 +1,256 @@
+/*
+ * SPI master on a USART in Master SPI Mode (MSPIM) for arduino.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 2
+ * or the GNU Lesser General Public License version 2.1, both as
+ * published by the Free Software Foundation.
+ */
+
+#include "USARTSPI.h"
+
+// The bits have the same positions in every USART, but their names
+// carry the USART number, so they are spelled out here.
+#define MSPIM_RXC   7 // UCSRnA
+#define MSPIM_TXC   6
+#define MSPIM_UDRE  5
+#define MSPIM_RXEN  4 // UCSRnB
+#define MSPIM_TXEN  3
+#define MSPIM_MODE  0xC0 // UCSRnC: UMSELn1 and UMSELn0
+#define MSPIM_UDORD 2
+#define MSPIM_UCPHA 1
+#define MSPIM_UCPOL 0
+
+USARTSPIClass::USARTSPIClass(volatile uint8_t *ubrrh, volatile uint8_t *ubrrl,
+                             volatile uint8_t *ucsra, volatile uint8_t *ucsrb,
+                             volatile uint8_t *ucsrc, volatile uint8_t *udr,
+                             uint8_t xckPin) :
+    _ubrrh(ubrrh), _ubrrl(ubrrl),
+    _ucsra(ucsra), _ucsrb(ucsrb), _ucsrc(ucsrc),
+    _udr(udr), _xckPin(xckPin),
+    _initialized(0), _interruptMode(0), _interruptMask(0), _interruptSave(0)
+{
+}
+
+void USARTSPIClass::begin()
+{
+  uint8_t sreg = SREG;
+  noInterrupts();
+  if (!_initialized) {
+    // The datasheet order: the baud rate register must be zero while the
+    // transmitter is enabled, and XCK an output, before MSPIM is selected
+    *_ubrrh = 0;
+    *_ubrrl = 0;
+    pinMode(_xckPin, OUTPUT);
+    *_ucsrc = MSPIM_MODE;
+    *_ucsrb = _BV(MSPIM_RXEN) | _BV(MSPIM_TXEN);
+    // same default as SPI: 4 MHz, MSB first, mode 0
+    applySettings(SPISettings());
+  }
+  _initialized++; // reference count
+  SREG = sreg;
+}
+
+void USARTSPIClass::end()
+{
+  uint8_t sreg = SREG;
+  noInterrupts();
+  if (_initialized)
+    _initialized--;
+  if (!_initialized) {
+    *_ucsrb = 0;
+    *_ucsrc = 0;
+    _interruptMode = 0;
+  }
+  SREG = sreg;
+}
+
+void USARTSPIClass::usingInterrupt(uint8_t interruptNumber)
+{
+  uint8_t sreg = SREG;
+  noInterrupts();
+  uint8_t mask = SPIClass::interruptNumberMask(interruptNumber);
+  if (!mask)
+    _interruptMode = 2;
+  _interruptMask |= mask;
+  if (!_interruptMode)
+    _interruptMode = 1;
+  SREG = sreg;
+}
+
+void USARTSPIClass::notUsingInterrupt(uint8_t interruptNumber)
+{
+  if (_interruptMode == 2)
+    return;
+  uint8_t sreg = SREG;
+  noInterrupts();
+  _interruptMask &= ~SPIClass::interruptNumberMask(interruptNumber);
+  if (!_interruptMask)
+    _interruptMode = 0;
+  SREG = sreg;
+}
+
+void USARTSPIClass::beginTransaction(SPISettings settings)
+{
+  if (_interruptMode > 0) {
+    uint8_t sreg = SREG;
+    noInterrupts();
+
+    #ifdef SPI_AVR_EIMSK
+    if (_interruptMode == 1) {
+      _interruptSave = SPI_AVR_EIMSK;
+      SPI_AVR_EIMSK &= ~_interruptMask;
+      SREG = sreg;
+    } else
+    #endif
+    {
+      _interruptSave = sreg;
+    }
+  }
+
+  applySettings(settings);
+}
+
+// Translates the SPCR/SPSR image: see SPISettings for the divider
+// encoding, which gives fosc / 2^(clockDiv + 1) with 7 meaning 128.
+// The USART runs at fosc / (2 * (UBRR + 1)).
+void USARTSPIClass::applySettings(const SPISettings &settings)
+{
+  uint8_t spcr = settings.spcr;
+  uint8_t clockDiv = (((spcr & SPI_CLOCK_MASK) << 1) |
+                      (settings.spsr & SPI_2XCLOCK_MASK)) ^ 0x1;
+  uint8_t ucsrc = MSPIM_MODE;
+  if (spcr & _BV(DORD)) ucsrc |= _BV(MSPIM_UDORD);
+  if (spcr & _BV(CPHA)) ucsrc |= _BV(MSPIM_UCPHA);
+  if (spcr & _BV(CPOL)) ucsrc |= _BV(MSPIM_UCPOL);
+  *_ucsrc = ucsrc;
+  *_ubrrl = clockDiv == 7 ? 63 : (1 << clockDiv) - 1;
+}
+
+void USARTSPIClass::endTransaction(void)
+{
+  if (_interruptMode > 0) {
+    #ifdef SPI_AVR_EIMSK
+    uint8_t sreg = SREG;
+    #endif
+    noInterrupts();
+    #ifdef SPI_AVR_EIMSK
+    if (_interruptMode == 1) {
+      SPI_AVR_EIMSK = _interruptSave;
+      SREG = sreg;
+    } else
+    #endif
+    {
+      SREG = _interruptSave;
+    }
+  }
+}
+
+uint8_t USARTSPIClass::transfer(uint8_t data)
+{
+  while (!(*_ucsra & _BV(MSPIM_UDRE))) ;
+  *_udr = data;
+  while (!(*_ucsra & _BV(MSPIM_RXC))) ;
+  return *_udr;
+}
+
+uint16_t USARTSPIClass::transfer16(uint16_t data)
+{
+  uint8_t buf[2];
+  if (*_ucsrc & _BV(MSPIM_UDORD)) {
+    buf[0] = data;
+    buf[1] = data >> 8;
+    transfer(buf, 2);
+    return buf[0] | (buf[1] << 8);
+  }
+  buf[0] = data >> 8;
+  buf[1] = data;
+  transfer(buf, 2);
+  return (buf[0] << 8) | buf[1];
+}
+
+void USARTSPIClass::transfer(void *buf, size_t count)
+{
+  transfer(buf, buf, count);
+}
+
+// At most two bytes are kept in flight, one shifting and one waiting in
+// the transmit buffer, so that the two byte receive buffer cannot
+// overflow. A received byte is only stored after the byte at the same
+// position has been sent, so txbuf and rxbuf may be the same.
+void USARTSPIClass::transfer(const void *txbuf, void *rxbuf, size_t count)
+{
+  if (!rxbuf) {
+    if (txbuf)
+      write(txbuf, count);
+    else
+      fill(0xFF, count);
+    return;
+  }
+  const uint8_t *tx = (const uint8_t *)txbuf;
+  uint8_t *rx = (uint8_t *)rxbuf;
+  size_t sent = 0;
+  size_t received = 0;
+  while (received < count) {
+    if (sent < count && sent - received < 2 && (*_ucsra & _BV(MSPIM_UDRE))) {
+      *_udr = tx ? tx[sent] : 0xFF;
+      sent++;
+    }
+    if (*_ucsra & _BV(MSPIM_RXC))
+      rx[received++] = *_udr;
+  }
+}
+
+// The functions below send with the receiver off, so nothing has to be
+// read back. Waiting for TXC at the end makes sure the last byte has left
+// before the caller raises chip select. Switching the receiver back on
+// also clears its buffer.
+void USARTSPIClass::beginSendOnly(void)
+{
+  *_ucsrb = _BV(MSPIM_TXEN);
+  // TXC is cleared by writing a one to it
+  *_ucsra |= _BV(MSPIM_TXC);
+}
+
+void USARTSPIClass::endSendOnly(void)
+{
+  while (!(*_ucsra & _BV(MSPIM_TXC))) ;
+  *_ucsrb = _BV(MSPIM_RXEN) | _BV(MSPIM_TXEN);
+}
+
+void USARTSPIClass::write(const void *buf, size_t count)
+{
+  if (count == 0) return;
+  const uint8_t *p = (const uint8_t *)buf;
+  beginSendOnly();
+  while (count--) {
+    uint8_t out = *p++;
+    while (!(*_ucsra & _BV(MSPIM_UDRE))) ;
+    *_udr = out;
+  }
+  endSendOnly();
+}
+
+void USARTSPIClass::write_P(const void *buf, size_t count)
+{
+  if (count == 0) return;
+  const uint8_t *p = (const uint8_t *)buf;
+  beginSendOnly();
+  while (count--) {
+    uint8_t out = pgm_read_byte(p++);
+    while (!(*_ucsra & _BV(MSPIM_UDRE))) ;
+    *_udr = out;
+  }
+  endSendOnly();
+}
+
+void USARTSPIClass::fill(uint8_t value, size_t count)
+{
+  if (count == 0) return;
+  beginSendOnly();
+  while (count--) {
+    while (!(*_ucsra & _BV(MSPIM_UDRE))) ;
+    *_udr = value;
+  }
+  endSendOnly();
+}
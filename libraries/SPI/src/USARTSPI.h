@@ -0,0 +1,74 @@
+/*
+ * SPI master on a USART in Master SPI Mode (MSPIM) for arduino.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 2
+ * or the GNU Lesser General Public License version 2.1, both as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _USARTSPI_H_INCLUDED
+#define _USARTSPI_H_INCLUDED
+
+#include "SPI.h"
+
+// A second SPI bus on a USART, for chips whose USARTs have Master SPI
+// Mode (e.g. ATmega328P, ATmega2560, ATmega32U4). TXD is MOSI, RXD is
+// MISO and XCK is SCK; chip selects are ordinary pins, as with SPI.
+// The USART cannot be used as a serial port (Serial.begin()) at the same
+// time.
+//
+// The interface follows SPIClass and takes the same SPISettings. The
+// clock is one of the same fosc/2 .. fosc/128 steps. Unlike SPDR, the
+// USART transmitter is double buffered, so the buffer functions keep the
+// next byte queued and send back to back without gaps.
+//
+// Instances are declared in the sketch with the registers of the USART
+// and the pin XCK is on, e.g. for USART0 of an ATmega328P (XCK0 is pin 4):
+//
+//   USARTSPIClass SPI1(&UBRR0H, &UBRR0L, &UCSR0A, &UCSR0B, &UCSR0C, &UDR0, 4);
+
+class USARTSPIClass {
+public:
+  USARTSPIClass(volatile uint8_t *ubrrh, volatile uint8_t *ubrrl,
+                volatile uint8_t *ucsra, volatile uint8_t *ucsrb,
+                volatile uint8_t *ucsrc, volatile uint8_t *udr,
+                uint8_t xckPin);
+
+  void begin();
+  void end();
+
+  // as SPIClass::usingInterrupt() and notUsingInterrupt(), for this bus
+  void usingInterrupt(uint8_t interruptNumber);
+  void notUsingInterrupt(uint8_t interruptNumber);
+
+  void beginTransaction(SPISettings settings);
+  void endTransaction(void);
+
+  uint8_t transfer(uint8_t data);
+  uint16_t transfer16(uint16_t data);
+  void transfer(void *buf, size_t count);
+  void transfer(const void *txbuf, void *rxbuf, size_t count);
+  void write(const void *buf, size_t count);
+  void write_P(const void *buf, size_t count);
+  void fill(uint8_t value, size_t count);
+
+private:
+  void applySettings(const SPISettings &settings);
+  void beginSendOnly(void);
+  void endSendOnly(void);
+
+  volatile uint8_t * const _ubrrh;
+  volatile uint8_t * const _ubrrl;
+  volatile uint8_t * const _ucsra;
+  volatile uint8_t * const _ucsrb;
+  volatile uint8_t * const _ucsrc;
+  volatile uint8_t * const _udr;
+  uint8_t _xckPin;
+  uint8_t _initialized;
+  uint8_t _interruptMode; // 0=none, 1=mask, 2=global
+  uint8_t _interruptMask;
+  uint8_t _interruptSave;
+};
+
+#endif
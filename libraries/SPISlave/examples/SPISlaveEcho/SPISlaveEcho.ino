@@ -0,0 +1,46 @@
+/*
+  SPI Slave Echo
+
+  This example makes the board an SPI slave that answers every frame the
+  master sends with the same bytes in the next frame. At the end of each
+  frame the received bytes are queued as the reply.
+
+ The circuit:
+  * SS - to digital pin 10, driven by the master's chip select
+  * MOSI - to digital pin 11
+  * MISO - to digital pin 12
+  * SCK - to digital pin 13
+  * GND - to the master's ground
+
+*/
+
+#include <SPISlave.h>
+
+// length of the last frame, 0 once it has been echoed
+volatile size_t frameLength = 0;
+
+// called from the interrupt when the master releases SS
+void frameReceived(size_t length) {
+  frameLength = length;
+}
+
+void setup() {
+  SPISlave.onFrame(frameReceived);
+  SPISlave.begin(SPI_MODE0, MSBFIRST);
+}
+
+void loop() {
+  noInterrupts();
+  size_t remaining = frameLength;
+  frameLength = 0;
+  interrupts();
+
+  // echo exactly the bytes of the frame
+  uint8_t buffer[32];
+  while (remaining > 0) {
+    int n = SPISlave.read(buffer, min(remaining, sizeof(buffer)));
+    if (n <= 0) break;
+    SPISlave.write(buffer, n);
+    remaining -= n;
+  }
+}
@@ -0,0 +1,224 @@
+/*
+ * SPI Slave library for arduino.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 2
+ * or the GNU Lesser General Public License version 2.1, both as
+ * published by the Free Software Foundation.
+ */
+
+#include <string.h>
+#include "SPISlave.h"
+
+#if SPI_SLAVE_RX_BUFFER_SIZE > 256 || SPI_SLAVE_TX_BUFFER_SIZE > 256
+#error SPI_SLAVE_RX_BUFFER_SIZE and SPI_SLAVE_TX_BUFFER_SIZE must be at most 256
+#endif
+
+SPISlaveClass SPISlave;
+
+// A reply byte leaves txBuffer only once it has been shifted out: it is
+// loaded into SPDR with replyLoaded set, and txTail is advanced by the
+// next transfer interrupt, unless WCOL shows that the master had already
+// started that byte when SPDR was written. A byte that missed its slot
+// is thus loaded again rather than lost.
+
+void SPISlaveClass::begin(uint8_t dataMode, uint8_t bitOrder)
+{
+  uint8_t sreg = SREG;
+  noInterrupts();
+  rxHead = rxTail = 0;
+  txHead = txTail = 0;
+  overrunCount = 0;
+  inFrame = false;
+  replyLoaded = false;
+
+  ssInput = portInputRegister(digitalPinToPort(SS));
+  ssMask = digitalPinToBitMask(SS);
+  misoMode = portModeRegister(digitalPinToPort(MISO));
+  misoMask = digitalPinToBitMask(MISO);
+
+  pinMode(SS, INPUT);
+  pinMode(SCK, INPUT);
+  pinMode(MOSI, INPUT);
+  pinMode(MISO, INPUT);
+
+  SPCR = _BV(SPE) | _BV(SPIE) | (dataMode & SPI_MODE_MASK) |
+    ((bitOrder == LSBFIRST) ? _BV(DORD) : 0);
+  // clear a leftover SPIF
+  (void)SPSR;
+  (void)SPDR;
+  SPDR = idleByte;
+
+#if defined(PCINT0_vect)
+  if (digitalPinToPCICR(SS)) {
+    *digitalPinToPCMSK(SS) |= _BV(digitalPinToPCMSKbit(SS));
+    *digitalPinToPCICR(SS) |= _BV(digitalPinToPCICRbit(SS));
+  }
+#endif
+  // the master may be selecting us already
+  _select_irq();
+  SREG = sreg;
+}
+
+void SPISlaveClass::end()
+{
+  uint8_t sreg = SREG;
+  noInterrupts();
+  SPCR = 0;
+#if defined(PCINT0_vect)
+  if (digitalPinToPCICR(SS))
+    *digitalPinToPCMSK(SS) &= ~_BV(digitalPinToPCMSKbit(SS));
+#endif
+  *misoMode &= ~misoMask;
+  inFrame = false;
+  SREG = sreg;
+}
+
+int SPISlaveClass::available(void)
+{
+  return ((unsigned int)(SPI_SLAVE_RX_BUFFER_SIZE + rxHead - rxTail)) % SPI_SLAVE_RX_BUFFER_SIZE;
+}
+
+int SPISlaveClass::peek(void)
+{
+  if (rxHead == rxTail)
+    return -1;
+  return rxBuffer[rxTail];
+}
+
+int SPISlaveClass::read(void)
+{
+  uint8_t tail = rxTail;
+  if (rxHead == tail)
+    return -1;
+  uint8_t c = rxBuffer[tail];
+  rxTail = (uint8_t)(tail + 1) % SPI_SLAVE_RX_BUFFER_SIZE;
+  return c;
+}
+
+int SPISlaveClass::read(uint8_t *buffer, size_t length)
+{
+  uint8_t head = rxHead;
+  uint8_t tail = rxTail;
+  size_t count = 0;
+  // Copy up to the head, in two runs if the data wraps around the end
+  // of the buffer
+  while (count < length && tail != head) {
+    size_t n = (head > tail ? head : SPI_SLAVE_RX_BUFFER_SIZE) - tail;
+    if (n > length - count) n = length - count;
+    memcpy(buffer + count, rxBuffer + tail, n);
+    count += n;
+    tail = (uint8_t)(tail + n) % SPI_SLAVE_RX_BUFFER_SIZE;
+  }
+  rxTail = tail;
+  return count;
+}
+
+int SPISlaveClass::availableForWrite(void)
+{
+  uint8_t head = txHead;
+  uint8_t tail = txTail;
+  if (head >= tail) return SPI_SLAVE_TX_BUFFER_SIZE - 1 - head + tail;
+  return tail - head - 1;
+}
+
+void SPISlaveClass::flush(void)
+{
+  while (txHead != txTail) ;
+}
+
+// Does not wait for room: only the master can make some
+size_t SPISlaveClass::write(uint8_t data)
+{
+  uint8_t head = txHead;
+  uint8_t next = (uint8_t)(head + 1) % SPI_SLAVE_TX_BUFFER_SIZE;
+  if (next == txTail)
+    return 0;
+  txBuffer[head] = data;
+  txHead = next;
+  return 1;
+}
+
+size_t SPISlaveClass::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (n < size && write(buffer[n]))
+    n++;
+  return n;
+}
+
+uint16_t SPISlaveClass::overruns(void)
+{
+  uint8_t sreg = SREG;
+  noInterrupts();
+  uint16_t count = overrunCount;
+  overrunCount = 0;
+  SREG = sreg;
+  return count;
+}
+
+// Called with interrupts disabled
+void SPISlaveClass::loadReply(void)
+{
+  uint8_t tail = txTail;
+  if (tail != txHead) {
+    SPDR = txBuffer[tail];
+    replyLoaded = true;
+  } else {
+    SPDR = idleByte;
+    replyLoaded = false;
+  }
+}
+
+void SPISlaveClass::_transfer_irq(void)
+{
+  // WCOL is cleared by this read of SPSR and the following access to SPDR
+  bool collided = SPSR & _BV(WCOL);
+  uint8_t in = SPDR;
+  if (replyLoaded && !collided)
+    txTail = (uint8_t)(txTail + 1) % SPI_SLAVE_TX_BUFFER_SIZE;
+  // the next byte may start any moment, so load the reply first
+  loadReply();
+
+  uint8_t head = rxHead;
+  uint8_t next = (uint8_t)(head + 1) % SPI_SLAVE_RX_BUFFER_SIZE;
+  if (next != rxTail) {
+    rxBuffer[head] = in;
+    rxHead = next;
+  } else if (overrunCount != 0xFFFF) {
+    overrunCount++;
+  }
+  frameLength++;
+}
+
+void SPISlaveClass::_select_irq(void)
+{
+  bool low = !(*ssInput & ssMask);
+  // another pin sharing the pin change interrupt
+  if (low == inFrame)
+    return;
+  inFrame = low;
+  if (low) {
+    frameLength = 0;
+    loadReply();
+    *misoMode |= misoMask;
+  } else {
+    *misoMode &= ~misoMask;
+    // a reply loaded but not clocked out stays in txBuffer
+    replyLoaded = false;
+    if (frameCallback)
+      frameCallback(frameLength);
+  }
+}
+
+ISR(SPI_STC_vect)
+{
+  SPISlave._transfer_irq();
+}
+
+#if defined(PCINT0_vect)
+ISR(PCINT0_vect)
+{
+  SPISlave._select_irq();
+}
+#endif
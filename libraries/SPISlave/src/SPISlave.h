@@ -0,0 +1,94 @@
+/*
+ * SPI Slave library for arduino.
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of either the GNU General Public License version 2
+ * or the GNU Lesser General Public License version 2.1, both as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _SPISLAVE_H_INCLUDED
+#define _SPISLAVE_H_INCLUDED
+
+#include <Arduino.h>
+#include <SPI.h>
+
+#ifndef SPI_SLAVE_RX_BUFFER_SIZE
+#define SPI_SLAVE_RX_BUFFER_SIZE 64
+#endif
+#ifndef SPI_SLAVE_TX_BUFFER_SIZE
+#define SPI_SLAVE_TX_BUFFER_SIZE 64
+#endif
+
+// Makes the board an SPI slave on the SPI pins, selected by the master
+// through SS. Each byte is handled by the SPI interrupt: the byte received
+// goes into the receive buffer, and the next byte written with write() (or
+// the idle byte, if there is none) is loaded to go out with the following
+// byte. A reply therefore trails the request by one byte, as with any AVR
+// SPI slave.
+//
+// A frame is everything between SS going low and going high again. The
+// SS pin change interrupt (PCINT0_vect, so SoftwareSerial cannot be used
+// alongside) loads the first reply byte, drives MISO only while the board
+// is selected, and calls the onFrame() callback at the end of a frame. A
+// reply byte that was loaded but not clocked out before the end of a
+// frame is sent again in the next one.
+//
+// The interrupt takes a few microseconds per byte, which the master has to
+// leave between bytes at higher SPI clocks.
+class SPISlaveClass : public Stream {
+public:
+  SPISlaveClass() : idleByte(0xFF) {}
+  void begin(uint8_t dataMode = SPI_MODE0, uint8_t bitOrder = MSBFIRST);
+  void end();
+
+  virtual int available(void);
+  virtual int peek(void);
+  virtual int read(void);
+  virtual int read(uint8_t *buffer, size_t length);
+  virtual int availableForWrite(void);
+  // waits until the master has clocked out every reply written
+  virtual void flush(void);
+  virtual size_t write(uint8_t data);
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  using Print::write;
+
+  // byte sent when no reply is waiting, 0xFF by default
+  void setIdleByte(uint8_t data) { idleByte = data; }
+  // callback(length) is called from the interrupt at the end of each
+  // frame with the number of bytes received in it
+  void onFrame(void (*callback)(size_t length)) { frameCallback = callback; }
+  // true while the master holds SS low
+  bool selected(void) { return inFrame; }
+  // bytes lost because the receive buffer was full; reading clears it
+  uint16_t overruns(void);
+
+  // Interrupt handlers - Not intended to be called externally
+  inline void _transfer_irq(void);
+  inline void _select_irq(void);
+
+private:
+  void loadReply(void);
+
+  volatile uint8_t *ssInput;
+  uint8_t ssMask;
+  volatile uint8_t *misoMode;
+  uint8_t misoMask;
+
+  uint8_t rxBuffer[SPI_SLAVE_RX_BUFFER_SIZE];
+  uint8_t txBuffer[SPI_SLAVE_TX_BUFFER_SIZE];
+  volatile uint8_t rxHead;
+  volatile uint8_t rxTail;
+  volatile uint8_t txHead;
+  volatile uint8_t txTail;
+  volatile uint16_t overrunCount;
+  volatile size_t frameLength;
+  volatile bool inFrame;
+  bool replyLoaded; // the byte in SPDR is txBuffer[txTail]
+  uint8_t idleByte;
+  void (*frameCallback)(size_t length);
+};
+
+extern SPISlaveClass SPISlave;
+
+#endif
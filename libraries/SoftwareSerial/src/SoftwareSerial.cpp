@@ -404,6 +404,23 @@ int SoftwareSerial::read()
   return d;
 }
 
+int SoftwareSerial::read(uint8_t *buffer, size_t length)
+{
+  if (!isListening())
+    return 0;
+
+  // The interrupt only moves the tail, so read it once and copy up to it
+  uint8_t tail = _receive_buffer_tail;
+  uint8_t head = _receive_buffer_head;
+  size_t count = 0;
+  while (count < length && head != tail) {
+    buffer[count++] = _receive_buffer[head];
+    head = (head + 1) % _SS_MAX_RX_BUFF;
+  }
+  _receive_buffer_head = head;
+  return count;
+}
+
 int SoftwareSerial::available()
 {
   if (!isListening())
@@ -30,6 +30,11 @@ extern "C" {
 
 #include "Wire.h"
 
+// Wire.h repeats these for sketches, so that they need not see twi.h
+#if WIRE_NO_STOP != TWI_NO_STOP || WIRE_REGISTER != TWI_REGISTER || WIRE_PENDING != TWI_PENDING
+#error "WIRE_ and TWI_ transaction constants differ"
+#endif
+
 // Initialize Class Variables //////////////////////////////////////////////////
 
 uint8_t TwoWire::rxBuffer[BUFFER_LENGTH];
@@ -87,6 +92,17 @@ void TwoWire::setClock(uint32_t clock)
   twi_setFrequency(clock);
 }
 
+void TwoWire::setClock(uint32_t clock, uint16_t riseTime)
+{
+  twi_setRiseTime(riseTime);
+  twi_setFrequency(clock);
+}
+
+uint32_t TwoWire::getClock(void)
+{
+  return twi_getFrequency();
+}
+
 /***
  * Sets the TWI timeout.
  *
@@ -133,30 +149,48 @@ void TwoWire::clearWireTimeoutFlag(void){
   twi_manageTimeoutFlag(true);
 }
 
+bool TwoWire::recoverBus(void)
+{
+  return twi_recoverBus();
+}
+
+void TwoWire::getStats(WireStats *stats, bool clear)
+{
+  twi_getStats(stats, clear);
+}
+
 uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint32_t iaddress, uint8_t isize, uint8_t sendStop)
 {
+  // clamp to buffer length
+  if(quantity > BUFFER_LENGTH){
+    quantity = BUFFER_LENGTH;
+  }
   if (isize > 0) {
   // send internal address; this mode allows sending a repeated start to access
   // some devices' internal registers. This function is executed by the hardware
   // TWI module on other processors (for example Due's TWI_IADR and TWI_MMR registers)
-
-  beginTransmission(address);
+  // Here the write and the read are a single transaction.
 
   // the maximum size of internal address is 3 bytes
   if (isize > 3){
     isize = 3;
   }
 
-  // write internal register address - most significant byte first
-  while (isize-- > 0)
-    write((uint8_t)(iaddress >> (isize*8)));
-  endTransmission(false);
-  }
+  // internal register address - most significant byte first
+  uint8_t iaddr[3];
+  for (uint8_t i = 0; i < isize; i++)
+    iaddr[i] = (uint8_t)(iaddress >> ((isize - 1 - i)*8));
 
-  // clamp to buffer length
-  if(quantity > BUFFER_LENGTH){
-    quantity = BUFFER_LENGTH;
+  WireTransaction t;
+  prepare(&t, address, iaddr, isize, rxBuffer, quantity, sendStop ? 0 : TWI_NO_STOP, NULL);
+  twi_queue(&t);
+  // like twi_readFrom(), any error (NACK, bus error, timeout) reads nothing
+  uint8_t read = twi_wait(&t) == 0 ? t.rxCount : 0;
+  rxBufferIndex = 0;
+  rxBufferLength = read;
+  return read;
   }
+
   // perform blocking read into buffer
   uint8_t read = twi_readFrom(address, rxBuffer, quantity, sendStop);
   // set rx buffer iterator vars
@@ -185,6 +219,44 @@ uint8_t TwoWire::requestFrom(int address, int quantity, int sendStop)
   return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)sendStop);
 }
 
+uint8_t TwoWire::writeTo(uint8_t address, const uint8_t *data, size_t length, bool sendStop)
+{
+  WireTransaction t;
+  prepare(&t, address, data, length, NULL, 0, sendStop ? 0 : TWI_NO_STOP, NULL);
+  twi_queue(&t);
+  return twi_wait(&t);
+}
+
+size_t TwoWire::readFrom(uint8_t address, uint8_t *data, size_t length, bool sendStop)
+{
+  WireTransaction t;
+  prepare(&t, address, NULL, 0, data, length, sendStop ? 0 : TWI_NO_STOP, NULL);
+  twi_queue(&t);
+  twi_wait(&t);
+  return t.rxCount;
+}
+
+// the register address and the data go out as one transaction, with a
+// repeated start before the read; nothing is copied
+size_t TwoWire::readRegisters(uint8_t address, uint8_t reg, uint8_t *data, size_t length)
+{
+  WireTransaction t;
+  prepare(&t, address, NULL, 0, data, length, TWI_REGISTER, NULL);
+  t.reg = reg;
+  twi_queue(&t);
+  twi_wait(&t);
+  return t.rxCount;
+}
+
+uint8_t TwoWire::writeRegisters(uint8_t address, uint8_t reg, const uint8_t *data, size_t length)
+{
+  WireTransaction t;
+  prepare(&t, address, data, length, NULL, 0, TWI_REGISTER, NULL);
+  t.reg = reg;
+  twi_queue(&t);
+  return twi_wait(&t);
+}
+
 void TwoWire::beginTransmission(uint8_t address)
 {
   // indicate that we are transmitting
@@ -301,6 +373,21 @@ int TwoWire::read(void)
   return value;
 }
 
+// must be called in:
+// slave rx event callback
+// or after requestFrom(address, numBytes)
+int TwoWire::read(uint8_t *data, size_t quantity)
+{
+  size_t count = rxBufferLength - rxBufferIndex;
+  if(count > quantity){
+    count = quantity;
+  }
+  memcpy(data, rxBuffer + rxBufferIndex, count);
+  rxBufferIndex += count;
+
+  return count;
+}
+
 // must be called in:
 // slave rx event callback
 // or after requestFrom(address, numBytes)
@@ -360,6 +447,46 @@ void TwoWire::onRequestService(void)
   user_onRequest();
 }
 
+// queues a transaction filled in by the caller
+void TwoWire::queue(WireTransaction *t)
+{
+  twi_queue(t);
+}
+
+void TwoWire::writeAsync(WireTransaction *t, uint8_t address, const uint8_t *data, size_t length, WireCallback callback)
+{
+  writeReadAsync(t, address, data, length, NULL, 0, callback);
+}
+
+void TwoWire::readAsync(WireTransaction *t, uint8_t address, uint8_t *data, size_t length, WireCallback callback)
+{
+  writeReadAsync(t, address, NULL, 0, data, length, callback);
+}
+
+// writes txLength bytes, then reads rxLength bytes after a repeated start
+void TwoWire::writeReadAsync(WireTransaction *t, uint8_t address, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength, WireCallback callback)
+{
+  prepare(t, address, txData, txLength, rxData, rxLength, 0, callback);
+  twi_queue(t);
+}
+
+// fills in a transaction
+void TwoWire::prepare(WireTransaction *t, uint8_t address, const uint8_t *txData, size_t txLength, uint8_t *rxData, size_t rxLength, uint8_t flags, WireCallback callback)
+{
+  t->address = address;
+  t->txData = txData;
+  t->txLength = txLength;
+  t->rxData = rxData;
+  t->rxLength = rxLength;
+  t->flags = flags;
+  t->callback = callback;
+}
+
+uint8_t TwoWire::wait(WireTransaction *t)
+{
+  return twi_wait(t);
+}
+
 // sets function called on slave write
 void TwoWire::onReceive( void (*function)(int) )
 {
@@ -25,8 +25,32 @@
 
 #include <inttypes.h>
 #include "Stream.h"
+#include "utility/twi_types.h"
 
+// Size of the master transmit and receive buffers, the same as the twi
+// buffers unless set separately for the build. writeTo() and readFrom()
+// do not use them and have no such limit.
+#ifndef BUFFER_LENGTH
+#ifdef TWI_BUFFER_LENGTH
+#define BUFFER_LENGTH TWI_BUFFER_LENGTH
+#else
 #define BUFFER_LENGTH 32
+#endif
+#endif
+#if BUFFER_LENGTH > 255
+#error "BUFFER_LENGTH must be at most 255"
+#endif
+
+// A queued transaction, see utility/twi_types.h. The sketch owns it and
+// its buffers. flags takes the WIRE_ values below, status is WIRE_PENDING
+// until the transaction is done.
+typedef twi_transaction WireTransaction;
+typedef void (*WireCallback)(WireTransaction *);
+typedef twi_stats WireStats;
+
+#define WIRE_NO_STOP 0x01  // keep the bus with a repeated start afterwards
+#define WIRE_REGISTER 0x02 // write reg before txData
+#define WIRE_PENDING 0xFF
 
 // WIRE_HAS_END means Wire has end()
 #define WIRE_HAS_END 1
@@ -48,6 +72,7 @@ class TwoWire : public Stream
     static void (*user_onReceive)(int);
     static void onRequestService(void);
     static void onReceiveService(uint8_t*, int);
+    static void prepare(WireTransaction *, uint8_t, const uint8_t *, size_t, uint8_t *, size_t, uint8_t, WireCallback);
   public:
     TwoWire();
     void begin();
@@ -55,9 +80,20 @@ class TwoWire : public Stream
     void begin(int);
     void end();
     void setClock(uint32_t);
+    // riseTime: SCL rise time in ns, which slows the bus down
+    void setClock(uint32_t, uint16_t riseTime);
+    // the SCL frequency the bus actually runs at
+    uint32_t getClock(void);
     void setWireTimeout(uint32_t timeout = 25000, bool reset_with_timeout = false);
     bool getWireTimeoutFlag(void);
     void clearWireTimeoutFlag(void);
+    // Resets the interface and clocks a slave that holds SDA low out of
+    // its byte, then sends a STOP; after a timeout, when setWireTimeout()
+    // was asked to reset, the next blocking call does this before it
+    // returns. True if the bus is free.
+    bool recoverBus(void);
+    // Copies the bus statistics and, if clear, starts them over.
+    void getStats(WireStats *, bool clear = false);
     void beginTransmission(uint8_t);
     void beginTransmission(int);
     uint8_t endTransmission(void);
@@ -67,15 +103,40 @@ class TwoWire : public Stream
     uint8_t requestFrom(uint8_t, uint8_t, uint32_t, uint8_t, uint8_t);
     uint8_t requestFrom(int, int);
     uint8_t requestFrom(int, int, int);
+    // Write or read length bytes straight from or into the caller's array,
+    // blocking. writeTo() returns a status as endTransmission() does,
+    // readFrom() the number of bytes read.
+    uint8_t writeTo(uint8_t, const uint8_t *, size_t, bool sendStop = true);
+    size_t readFrom(uint8_t, uint8_t *, size_t, bool sendStop = true);
+    // Read length bytes from the device's registers, starting at reg, in a
+    // single transaction with a repeated start, or write them. Same
+    // results as readFrom() and writeTo().
+    size_t readRegisters(uint8_t, uint8_t, uint8_t *, size_t);
+    uint8_t writeRegisters(uint8_t, uint8_t, const uint8_t *, size_t);
     virtual size_t write(uint8_t);
     virtual size_t write(const uint8_t *, size_t);
     virtual int available(void);
     virtual int read(void);
+    virtual int read(uint8_t *, size_t);
     virtual int peek(void);
     virtual void flush(void);
     void onReceive( void (*)(int) );
     void onRequest( void (*)(void) );
 
+    // Queue a transaction and return at once; it runs from the TWI
+    // interrupt, right after those queued before it. callback, if given,
+    // is called from the interrupt when it is done.
+    void writeAsync(WireTransaction *, uint8_t, const uint8_t *, size_t, WireCallback = NULL);
+    void readAsync(WireTransaction *, uint8_t, uint8_t *, size_t, WireCallback = NULL);
+    void writeReadAsync(WireTransaction *, uint8_t, const uint8_t *, size_t, uint8_t *, size_t, WireCallback = NULL);
+    void queue(WireTransaction *);
+    // true once the transaction is done, its status then coded as for
+    // endTransmission() and rxCount holding the bytes read
+    bool done(const WireTransaction *t) { return t->status != WIRE_PENDING; }
+    // waits for the transaction, subject to setWireTimeout(), and returns
+    // its status
+    uint8_t wait(WireTransaction *);
+
     inline size_t write(unsigned long n) { return write((uint8_t)n); }
     inline size_t write(long n) { return write((uint8_t)n); }
     inline size_t write(unsigned int n) { return write((uint8_t)n); }
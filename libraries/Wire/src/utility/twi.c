@@ -22,6 +22,7 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
@@ -42,7 +43,6 @@
 
 static volatile uint8_t twi_state;
 static volatile uint8_t twi_slarw;
-static volatile uint8_t twi_sendStop;			// should the transaction end with a stop
 static volatile uint8_t twi_inRepStart;			// in the middle of a repeated start
 
 // twi_timeout_us > 0 prevents the code from getting stuck in various while loops here
@@ -54,13 +54,22 @@ static volatile uint8_t twi_inRepStart;			// in the middle of a repeated start
 static volatile uint32_t twi_timeout_us = 0ul;
 static volatile bool twi_timed_out_flag = false;  // a timeout has been seen
 static volatile bool twi_do_reset_on_timeout = false;  // reset the TWI registers on timeout
+static volatile bool twi_recovery_pending = false;  // reset left to twi_wait()
 
 static void (*twi_onSlaveTransmit)(void);
 static void (*twi_onSlaveReceive)(uint8_t*, int);
 
 static uint8_t twi_masterBuffer[TWI_BUFFER_LENGTH];
-static volatile uint8_t twi_masterBufferIndex;
-static volatile uint8_t twi_masterBufferLength;
+static uint8_t* twi_masterData;                 // buffer of the running transfer
+static volatile size_t twi_masterBufferIndex;
+static volatile size_t twi_masterBufferLength;
+static volatile uint8_t twi_regPending;         // register address still to send
+
+// queued master transactions, the head is the one on the bus
+static twi_transaction* volatile twi_queueHead;
+static twi_transaction* twi_queueTail;
+// the transaction behind twi_writeTo() and twi_readFrom()
+static twi_transaction twi_syncTransaction;
 
 static uint8_t twi_txBuffer[TWI_BUFFER_LENGTH];
 static volatile uint8_t twi_txBufferIndex;
@@ -71,6 +80,12 @@ static volatile uint8_t twi_rxBufferIndex;
 
 static volatile uint8_t twi_error;
 
+static uint16_t twi_riseCycles;                 // SCL rise time in cpu cycles
+
+static twi_stats twi_stat;
+
+static void twi_abort(uint8_t);
+
 /* 
  * Function twi_init
  * Desc     readys twi pins and sets twi bitrate
@@ -81,7 +96,6 @@ void twi_init(void)
 {
   // initialize state
   twi_state = TWI_READY;
-  twi_sendStop = true;		// default value
   twi_inRepStart = false;
   
   // activate internal pullups for twi.
@@ -89,14 +103,7 @@ void twi_init(void)
   digitalWrite(SCL, 1);
 
   // initialize twi prescaler and bit rate
-  cbi(TWSR, TWPS0);
-  cbi(TWSR, TWPS1);
-  TWBR = ((F_CPU / TWI_FREQ) - 16) / 2;
-
-  /* twi bit rate formula from atmega128 manual pg 204
-  SCL Frequency = CPU Clock Frequency / (16 + (2 * TWBR))
-  note: TWBR should be 10 or higher for master mode
-  It is 72 for a 16mhz Wiring board with 100kHz TWI */
+  twi_setFrequency(TWI_FREQ);
 
   // enable twi module, acks, and twi interrupt
   TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA);
@@ -113,6 +120,9 @@ void twi_disable(void)
   // disable twi module, acks, and twi interrupt
   TWCR &= ~(_BV(TWEN) | _BV(TWIE) | _BV(TWEA));
 
+  // fail whatever was still queued
+  twi_abort(4);
+
   // deactivate internal pullups for twi.
   digitalWrite(SDA, 0);
   digitalWrite(SCL, 0);
@@ -132,18 +142,65 @@ void twi_setAddress(uint8_t address)
 
 /* 
  * Function twi_setClock
- * Desc     sets twi bit rate
+ * Desc     sets twi bit rate, the highest one not above frequency
+ *          the fastest is F_CPU / 16, 1MHz (Fast-mode Plus) at 16MHz,
+ *          the slowest F_CPU / 32656, about 490Hz at 16MHz
  * Input    Clock Frequency
  * Output   none
  */
 void twi_setFrequency(uint32_t frequency)
 {
-  TWBR = ((F_CPU / frequency) - 16) / 2;
-  
-  /* twi bit rate formula from atmega128 manual pg 204
-  SCL Frequency = CPU Clock Frequency / (16 + (2 * TWBR))
-  note: TWBR should be 10 or higher for master mode
-  It is 72 for a 16mhz Wiring board with 100kHz TWI */
+  /* twi bit rate formula from atmega328p manual 22.5.2
+  SCL Frequency = CPU Clock Frequency / (16 + (2 * TWBR * 4^TWPS))
+  The SCL high period only starts once SCL has risen, which adds the rise
+  time to the period. Pick the smallest prescaler for which TWBR fits,
+  rounding TWBR up so the bus never runs faster than asked.
+  note: on older chips TWBR should be 10 or higher for master mode */
+  uint32_t cycles = (F_CPU + frequency - 1) / frequency;
+  uint32_t fixed = 16 + twi_riseCycles;
+  uint8_t prescaler = 0;
+  uint32_t bitrate = 0;
+  if (cycles > fixed) {
+    cycles -= fixed;
+    for (;;) {
+      uint32_t step = 2ul << (2 * prescaler);
+      bitrate = (cycles + step - 1) / step;
+      if (bitrate <= 255)
+        break;
+      if (prescaler == 3) {
+        bitrate = 255;
+        break;
+      }
+      prescaler++;
+    }
+  }
+  TWSR = (TWSR & ~(_BV(TWPS1) | _BV(TWPS0))) | prescaler;
+  TWBR = bitrate;
+}
+
+/* 
+ * Function twi_getFrequency
+ * Desc     gets the twi bit rate the bus actually runs at, including the
+ *          rise time set with twi_setRiseTime()
+ * Input    none
+ * Output   SCL frequency in Hz
+ */
+uint32_t twi_getFrequency(void)
+{
+  uint8_t prescaler = TWSR & (_BV(TWPS1) | _BV(TWPS0));
+  return F_CPU / (16 + ((uint32_t)TWBR << (2 * prescaler + 1)) + twi_riseCycles);
+}
+
+/* 
+ * Function twi_setRiseTime
+ * Desc     sets the SCL rise time, set by the pullups and bus capacitance,
+ *          for twi_setFrequency() to allow for; 0 by default
+ * Input    riseTime: rise time in ns
+ * Output   none
+ */
+void twi_setRiseTime(uint16_t riseTime)
+{
+  twi_riseCycles = ((uint32_t)riseTime * (F_CPU / 10000) + 50000) / 100000;
 }
 
 /* 
@@ -158,80 +215,27 @@ void twi_setFrequency(uint32_t frequency)
  */
 uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length, uint8_t sendStop)
 {
-  uint8_t i;
-
-  // ensure data will fit into buffer
-  if(TWI_BUFFER_LENGTH < length){
+  // twi_syncTransaction may still be in use by a twi_writeTo() that did not wait
+  if(TWI_PENDING == twi_syncTransaction.status && 5 == twi_wait(&twi_syncTransaction)){
     return 0;
   }
 
-  // wait until twi is ready, become master receiver
-  uint32_t startMicros = micros();
-  while(TWI_READY != twi_state){
-    if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
-      twi_handleTimeout(twi_do_reset_on_timeout);
-      return 0;
-    }
-  }
-  twi_state = TWI_MRX;
-  twi_sendStop = sendStop;
-  // reset error state (0xFF.. no error occurred)
-  twi_error = 0xFF;
-
-  // initialize buffer iteration vars
-  twi_masterBufferIndex = 0;
-  twi_masterBufferLength = length-1;  // This is not intuitive, read on...
-  // On receive, the previously configured ACK/NACK setting is transmitted in
-  // response to the received byte before the interrupt is signalled. 
-  // Therefore we must actually set NACK when the _next_ to last byte is
-  // received, causing that NACK to be sent in response to receiving the last
-  // expected byte of data.
-
-  // build sla+w, slave device address + w bit
-  twi_slarw = TW_READ;
-  twi_slarw |= address << 1;
-
-  if (true == twi_inRepStart) {
-    // if we're in the repeated start state, then we've already sent the start,
-    // (@@@ we hope), and the TWI statemachine is just waiting for the address byte.
-    // We need to remove ourselves from the repeated start state before we enable interrupts,
-    // since the ISR is ASYNC, and we could get confused if we hit the ISR before cleaning
-    // up. Also, don't enable the START interrupt. There may be one pending from the 
-    // repeated start that we sent ourselves, and that would really confuse things.
-    twi_inRepStart = false;			// remember, we're dealing with an ASYNC ISR
-    startMicros = micros();
-    do {
-      TWDR = twi_slarw;
-      if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
-        twi_handleTimeout(twi_do_reset_on_timeout);
-        return 0;
-      }
-    } while(TWCR & _BV(TWWC));
-    TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE);	// enable INTs, but not START
-  } else {
-    // send start condition
-    TWCR = _BV(TWEN) | _BV(TWIE) | _BV(TWEA) | _BV(TWINT) | _BV(TWSTA);
-  }
+  twi_syncTransaction.address = address;
+  twi_syncTransaction.txData = NULL;
+  twi_syncTransaction.txLength = 0;
+  twi_syncTransaction.rxData = data;
+  twi_syncTransaction.rxLength = length;
+  twi_syncTransaction.flags = sendStop ? 0 : TWI_NO_STOP;
+  twi_syncTransaction.callback = NULL;
+  twi_queue(&twi_syncTransaction);
 
   // wait for read operation to complete
-  startMicros = micros();
-  while(TWI_MRX == twi_state){
-    if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
-      twi_handleTimeout(twi_do_reset_on_timeout);
-      return 0;
-    }
-  }
-
-  if (twi_masterBufferIndex < length) {
-    length = twi_masterBufferIndex;
-  }
-
-  // copy twi buffer to data
-  for(i = 0; i < length; ++i){
-    data[i] = twi_masterBuffer[i];
+  if(5 == twi_wait(&twi_syncTransaction)){
+    return 0;
   }
 
-  return length;
+  // the bytes were read straight into data
+  return twi_syncTransaction.rxCount;
 }
 
 /* 
@@ -244,7 +248,7 @@ uint8_t twi_readFrom(uint8_t address, uint8_t* data, uint8_t length, uint8_t sen
  *          wait: boolean indicating to wait for write or not
  *          sendStop: boolean indicating whether or not to send a stop at the end
  * Output   0 .. success
- *          1 .. length to long for buffer
+ *          1 .. length to long for buffer (only if not waiting)
  *          2 .. address send, NACK received
  *          3 .. data send, NACK received
  *          4 .. other twi error (lost bus arbitration, bus error, ..)
@@ -254,79 +258,38 @@ uint8_t twi_writeTo(uint8_t address, uint8_t* data, uint8_t length, uint8_t wait
 {
   uint8_t i;
 
-  // ensure data will fit into buffer
-  if(TWI_BUFFER_LENGTH < length){
-    return 1;
+  // twi_syncTransaction may still be in use by a twi_writeTo() that did not wait
+  if(TWI_PENDING == twi_syncTransaction.status && 5 == twi_wait(&twi_syncTransaction)){
+    return 5;
   }
 
-  // wait until twi is ready, become master transmitter
-  uint32_t startMicros = micros();
-  while(TWI_READY != twi_state){
-    if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
-      twi_handleTimeout(twi_do_reset_on_timeout);
-      return (5);
+  // data is sent straight from the caller's array if we wait, otherwise
+  // it is copied, as the caller may reuse the array on return
+  if(!wait){
+    // ensure data will fit into buffer
+    if(TWI_BUFFER_LENGTH < length){
+      return 1;
     }
+    for(i = 0; i < length; ++i){
+      twi_masterBuffer[i] = data[i];
+    }
+    data = twi_masterBuffer;
   }
-  twi_state = TWI_MTX;
-  twi_sendStop = sendStop;
-  // reset error state (0xFF.. no error occurred)
-  twi_error = 0xFF;
 
-  // initialize buffer iteration vars
-  twi_masterBufferIndex = 0;
-  twi_masterBufferLength = length;
-  
-  // copy data to twi buffer
-  for(i = 0; i < length; ++i){
-    twi_masterBuffer[i] = data[i];
-  }
-  
-  // build sla+w, slave device address + w bit
-  twi_slarw = TW_WRITE;
-  twi_slarw |= address << 1;
-  
-  // if we're in a repeated start, then we've already sent the START
-  // in the ISR. Don't do it again.
-  //
-  if (true == twi_inRepStart) {
-    // if we're in the repeated start state, then we've already sent the start,
-    // (@@@ we hope), and the TWI statemachine is just waiting for the address byte.
-    // We need to remove ourselves from the repeated start state before we enable interrupts,
-    // since the ISR is ASYNC, and we could get confused if we hit the ISR before cleaning
-    // up. Also, don't enable the START interrupt. There may be one pending from the 
-    // repeated start that we sent ourselves, and that would really confuse things.
-    twi_inRepStart = false;			// remember, we're dealing with an ASYNC ISR
-    startMicros = micros();
-    do {
-      TWDR = twi_slarw;
-      if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
-        twi_handleTimeout(twi_do_reset_on_timeout);
-        return (5);
-      }
-    } while(TWCR & _BV(TWWC));
-    TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE);	// enable INTs, but not START
-  } else {
-    // send start condition
-    TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTA);	// enable INTs
-  }
+  twi_syncTransaction.address = address;
+  twi_syncTransaction.txData = data;
+  twi_syncTransaction.txLength = length;
+  twi_syncTransaction.rxData = NULL;
+  twi_syncTransaction.rxLength = 0;
+  twi_syncTransaction.flags = sendStop ? 0 : TWI_NO_STOP;
+  twi_syncTransaction.callback = NULL;
+  twi_queue(&twi_syncTransaction);
 
   // wait for write operation to complete
-  startMicros = micros();
-  while(wait && (TWI_MTX == twi_state)){
-    if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
-      twi_handleTimeout(twi_do_reset_on_timeout);
-      return (5);
-    }
+  if(!wait){
+    return 0;
   }
-  
-  if (twi_error == 0xFF)
-    return 0;	// success
-  else if (twi_error == TW_MT_SLA_NACK)
-    return 2;	// error: address send, nack received
-  else if (twi_error == TW_MT_DATA_NACK)
-    return 3;	// error: data send, nack received
-  else
-    return 4;	// other twi error
+  return twi_wait(&twi_syncTransaction);
 }
 
 /* 
@@ -464,24 +427,24 @@ void twi_setTimeoutInMicros(uint32_t timeout, bool reset_with_timeout){
  * Function twi_handleTimeout
  * Desc     this gets called whenever a while loop here has lasted longer than
  *          twi_timeout_us microseconds. always sets twi_timed_out_flag
- * Input    reset: true causes this function to reset the twi hardware interface
+ *          may run in the TWI interrupt or with interrupts disabled, so the
+ *          reset, which takes milliseconds, is left to twi_wait()
+ * Input    reset: true causes the twi hardware interface to be reset
  * Output   none
  */
 void twi_handleTimeout(bool reset){
   twi_timed_out_flag = true;
 
-  if (reset) {
-    // remember bitrate and address settings
-    uint8_t previous_TWBR = TWBR;
-    uint8_t previous_TWAR = TWAR;
+  uint8_t sreg = SREG;
+  cli();
+  twi_stat.timeouts++;
+  SREG = sreg;
 
-    // reset the interface
-    twi_disable();
-    twi_init();
+  // the transaction that timed out, and any queued behind it, fail
+  twi_abort(5);
 
-    // reapply the previous register values
-    TWAR = previous_TWAR;
-    TWBR = previous_TWBR;
+  if (reset) {
+    twi_recovery_pending = true;
   }
 }
 
@@ -500,8 +463,325 @@ bool twi_manageTimeoutFlag(bool clear_flag){
   return(flag);
 }
 
+/*
+ * Function twi_load
+ * Desc     sets up the first part of a transaction: the write, unless
+ *          there is nothing to write but something to read
+ * Input    t: the transaction
+ * Output   none
+ */
+static void twi_load(twi_transaction* t)
+{
+  // reset error state (0xFF.. no error occurred)
+  twi_error = 0xFF;
+  twi_masterBufferIndex = 0;
+  twi_regPending = t->flags & TWI_REGISTER;
+  if(t->txLength || !t->rxLength || twi_regPending){
+    twi_state = TWI_MTX;
+    twi_slarw = TW_WRITE | (t->address << 1);
+    twi_masterData = (uint8_t*)t->txData;
+    twi_masterBufferLength = t->txLength;
+  }else{
+    twi_state = TWI_MRX;
+    twi_slarw = TW_READ | (t->address << 1);
+    twi_masterData = t->rxData;
+    // On receive, the previously configured ACK/NACK setting is transmitted in
+    // response to the received byte before the interrupt is signalled.
+    // Therefore we must actually set NACK when the _next_ to last byte is
+    // received, causing that NACK to be sent in response to receiving the last
+    // expected byte of data.
+    twi_masterBufferLength = t->rxLength - 1;
+  }
+}
+
+/*
+ * Function twi_start
+ * Desc     puts the transaction at the head of the queue on the bus
+ *          called with interrupts disabled while twi_state is TWI_READY
+ * Input    none
+ * Output   none
+ */
+static void twi_start(void)
+{
+  twi_load(twi_queueHead);
+
+  if (true == twi_inRepStart) {
+    // if we're in the repeated start state, then we've already sent the start,
+    // (@@@ we hope), and the TWI statemachine is just waiting for the address byte.
+    // Also, don't enable the START interrupt. There may be one pending from the
+    // repeated start that we sent ourselves, and that would really confuse things.
+    // Interrupts are disabled here, so approximate the timeout as twi_stop() does.
+    twi_inRepStart = false;
+    const uint8_t us_per_loop = 8;
+    uint32_t counter = (twi_timeout_us + us_per_loop - 1)/us_per_loop; // Round up
+    do {
+      TWDR = twi_slarw;
+      if(twi_timeout_us > 0ul){
+        if (counter > 0ul){
+          _delay_us(us_per_loop);
+          counter--;
+        } else {
+          twi_handleTimeout(twi_do_reset_on_timeout);
+          return;
+        }
+      }
+    } while(TWCR & _BV(TWWC));
+    TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE);	// enable INTs, but not START
+  } else {
+    // send start condition
+    TWCR = _BV(TWINT) | _BV(TWEA) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTA);	// enable INTs
+  }
+}
+
+/*
+ * Function twi_finish
+ * Desc     ends the transaction on the bus, from the interrupt, and goes
+ *          on with the next one: after a repeated start if this one asked
+ *          to keep the bus, otherwise after a STOP
+ * Input    none
+ * Output   none
+ */
+static void twi_finish(void)
+{
+  twi_transaction* t = twi_queueHead;
+  uint8_t status;
+  if (twi_error == 0xFF)
+    status = 0;	// success
+  else if (twi_error == TW_MT_SLA_NACK || twi_error == TW_MR_SLA_NACK)
+    status = 2;	// error: address send, nack received
+  else if (twi_error == TW_MT_DATA_NACK)
+    status = 3;	// error: data send, nack received
+  else
+    status = 4;	// other twi error
+  if (twi_state == TWI_MRX) {
+    t->rxCount = twi_masterBufferIndex;
+  }
+
+  twi_stat.transactions++;
+  if (status == 2 || status == 3)
+    twi_stat.nacks++;
+  else if (twi_error == TW_MT_ARB_LOST)
+    twi_stat.arbitrationLost++;
+  else if (twi_error == TW_BUS_ERROR)
+    twi_stat.busErrors++;
+
+  twi_transaction* next = t->next;
+  twi_queueHead = next;
+  if (!next) {
+    twi_queueTail = NULL;
+  }
+
+  if (twi_error == TW_MT_ARB_LOST) {
+    twi_releaseBus();
+    if (next) {
+      twi_start();
+    }
+  } else if (status == 0 && (t->flags & TWI_NO_STOP)) {
+    if (next) {
+      twi_load(next);
+      TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN) | _BV(TWIE) | _BV(TWEA);
+    } else {
+      twi_inRepStart = true;	// we're gonna send the START
+      // don't enable the interrupt. We'll generate the start, but we
+      // avoid handling the interrupt until we're in the next transaction,
+      // at the point where we would normally issue the start.
+      TWCR = _BV(TWINT) | _BV(TWSTA)| _BV(TWEN) ;
+      twi_state = TWI_READY;
+    }
+  } else if (next) {
+    // STOP, then START as soon as the STOP is done
+    twi_load(next);
+    TWCR = _BV(TWINT) | _BV(TWSTO) | _BV(TWSTA) | _BV(TWEN) | _BV(TWIE) | _BV(TWEA);
+  } else {
+    twi_stop();
+  }
+
+  t->status = status;
+  if (t->callback) {
+    t->callback(t);
+  }
+}
+
+/*
+ * Function twi_abort
+ * Desc     removes all queued transactions, giving them a status
+ *          a master transfer still on the bus is cut off by switching the
+ *          interface off and on again (if it is enabled), so that no late
+ *          interrupt reads or writes buffers the callers may have freed
+ * Input    status: the status for the transactions
+ * Output   none
+ */
+static void twi_abort(uint8_t status)
+{
+  uint8_t sreg = SREG;
+  cli();
+  twi_transaction* t = twi_queueHead;
+  twi_queueHead = NULL;
+  twi_queueTail = NULL;
+  if (twi_state == TWI_MTX || twi_state == TWI_MRX) {
+    if (TWCR & _BV(TWEN)) {
+      // clearing TWEN ends the transfer; TWINT discards its interrupt
+      TWCR = 0;
+      TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | _BV(TWEA);
+    }
+    twi_masterData = twi_masterBuffer;
+    twi_masterBufferLength = 0;
+    twi_state = TWI_READY;
+  }
+  while (t) {
+    twi_transaction* next = t->next;
+    t->status = status;
+    if (t->callback) {
+      t->callback(t);
+    }
+    t = next;
+  }
+  SREG = sreg;
+}
+
+/*
+ * Function twi_queue
+ * Desc     queues a master transaction, which starts right away if the
+ *          bus is free; returns without waiting for it
+ * Input    t: the transaction, see twi.h
+ * Output   none
+ */
+void twi_queue(twi_transaction* t)
+{
+  t->next = NULL;
+  t->rxCount = 0;
+  t->status = TWI_PENDING;
+
+  uint8_t sreg = SREG;
+  cli();
+  if (twi_queueTail) {
+    twi_queueTail->next = t;
+  } else {
+    twi_queueHead = t;
+  }
+  twi_queueTail = t;
+  if (TWI_READY == twi_state && twi_queueHead == t) {
+    twi_start();
+  }
+  SREG = sreg;
+}
+
+/*
+ * Function twi_wait
+ * Desc     waits for a queued transaction to complete, subject to the
+ *          timeout set with twi_setTimeoutInMicros()
+ * Input    t: the transaction
+ * Output   its status, as for twi_writeTo()
+ */
+uint8_t twi_wait(twi_transaction* t)
+{
+  uint32_t startMicros = micros();
+  while(TWI_PENDING == t->status){
+    if((twi_timeout_us > 0ul) && ((micros() - startMicros) > twi_timeout_us)) {
+      twi_handleTimeout(twi_do_reset_on_timeout);
+      break;
+    }
+  }
+  twi_stat.waitMicros += micros() - startMicros;
+
+  // reset the interface, freeing the bus from a slave that holds it, after
+  // a timeout here or in the interrupt
+  if (twi_recovery_pending) {
+    twi_recoverBus();
+  }
+  return TWI_PENDING == t->status ? 5 : t->status;
+}
+
+/*
+ * Function twi_recoverBus
+ * Desc     resets the interface and frees the bus from a slave stuck in the
+ *          middle of a byte, holding SDA low: clocks SCL by hand, up to 9
+ *          times, until the slave lets go of SDA, then sends a STOP
+ *          queued transactions fail, the bitrate and address are kept
+ * Input    none
+ * Output   true if SDA and SCL are both high afterwards
+ */
+bool twi_recoverBus(void)
+{
+  // remember bitrate and address settings
+  uint8_t previous_TWBR = TWBR;
+  uint8_t previous_TWSR = TWSR;
+  uint8_t previous_TWAR = TWAR;
+
+  twi_recovery_pending = false;
+  twi_disable();
+
+  uint8_t sreg = SREG;
+  cli();
+  twi_stat.recoveries++;
+  SREG = sreg;
+
+  // open drain: a line is pulled low as an output, released as an input
+  // with its pullup; half periods of 5us make a 100kHz clock
+  pinMode(SDA, INPUT_PULLUP);
+  pinMode(SCL, INPUT_PULLUP);
+  delayMicroseconds(5);
+
+  for (uint8_t i = 0; i < 9 && !digitalRead(SDA); i++) {
+    digitalWrite(SCL, LOW);
+    pinMode(SCL, OUTPUT);
+    delayMicroseconds(5);
+    pinMode(SCL, INPUT_PULLUP);
+    // the slave may stretch the clock
+    for (uint8_t wait = 0; wait < 100 && !digitalRead(SCL); wait++) {
+      delayMicroseconds(5);
+    }
+    delayMicroseconds(5);
+  }
+
+  // STOP: SDA rises while SCL is high
+  digitalWrite(SCL, LOW);
+  pinMode(SCL, OUTPUT);
+  digitalWrite(SDA, LOW);
+  pinMode(SDA, OUTPUT);
+  delayMicroseconds(5);
+  pinMode(SCL, INPUT_PULLUP);
+  delayMicroseconds(5);
+  pinMode(SDA, INPUT_PULLUP);
+  delayMicroseconds(5);
+  bool released = digitalRead(SDA) && digitalRead(SCL);
+
+  twi_init();
+
+  // reapply the previous register values
+  TWAR = previous_TWAR;
+  TWBR = previous_TWBR;
+  TWSR = previous_TWSR & (_BV(TWPS1) | _BV(TWPS0));
+
+  return released;
+}
+
+/*
+ * Function twi_getStats
+ * Desc     copies the bus statistics
+ * Input    stats: where to copy them
+ *          clear: start counting from zero again
+ * Output   none
+ */
+void twi_getStats(twi_stats* stats, bool clear)
+{
+  uint8_t sreg = SREG;
+  cli();
+  *stats = twi_stat;
+  if (clear) {
+    memset(&twi_stat, 0, sizeof(twi_stat));
+  }
+  SREG = sreg;
+}
+
 ISR(TWI_vect)
 {
+  // a master interrupt for a transaction that was aborted on a timeout
+  if(TW_STATUS >= TW_START && TW_STATUS < TW_SR_SLA_ACK && !twi_queueHead){
+    twi_stop();
+    return;
+  }
+
   switch(TW_STATUS){
     // All Master
     case TW_START:     // sent start condition
@@ -514,41 +794,53 @@ ISR(TWI_vect)
     // Master Transmitter
     case TW_MT_SLA_ACK:  // slave receiver acked address
     case TW_MT_DATA_ACK: // slave receiver acked data
-      // if there is data to send, send it, otherwise stop 
-      if(twi_masterBufferIndex < twi_masterBufferLength){
+      // if there is data to send, send it, otherwise go on; the byte just
+      // acked was the register address while no data has been sent yet
+      if(TW_STATUS == TW_MT_DATA_ACK && twi_masterBufferIndex){
+        twi_stat.bytes++;
+      }
+      if(twi_regPending){
+        // the register address goes first
+        TWDR = twi_queueHead->reg;
+        twi_regPending = false;
+        twi_reply(1);
+      }else if(twi_masterBufferIndex < twi_masterBufferLength){
         // copy data to output register and ack
-        TWDR = twi_masterBuffer[twi_masterBufferIndex++];
+        TWDR = twi_masterData[twi_masterBufferIndex++];
         twi_reply(1);
+      }else if(twi_queueHead->rxLength){
+        // read the rest after a repeated start
+        twi_state = TWI_MRX;
+        twi_slarw = TW_READ | (twi_queueHead->address << 1);
+        twi_masterData = twi_queueHead->rxData;
+        twi_masterBufferIndex = 0;
+        twi_masterBufferLength = twi_queueHead->rxLength - 1;
+        TWCR = _BV(TWINT) | _BV(TWSTA) | _BV(TWEN) | _BV(TWIE) | _BV(TWEA);
       }else{
-        if (twi_sendStop){
-          twi_stop();
-       } else {
-         twi_inRepStart = true;	// we're gonna send the START
-         // don't enable the interrupt. We'll generate the start, but we
-         // avoid handling the interrupt until we're in the next transaction,
-         // at the point where we would normally issue the start.
-         TWCR = _BV(TWINT) | _BV(TWSTA)| _BV(TWEN) ;
-         twi_state = TWI_READY;
-        }
+        twi_finish();
       }
       break;
     case TW_MT_SLA_NACK:  // address sent, nack received
       twi_error = TW_MT_SLA_NACK;
-      twi_stop();
+      twi_finish();
       break;
     case TW_MT_DATA_NACK: // data sent, nack received
+      if(twi_masterBufferIndex){
+        twi_stat.bytes++;
+      }
       twi_error = TW_MT_DATA_NACK;
-      twi_stop();
+      twi_finish();
       break;
     case TW_MT_ARB_LOST: // lost bus arbitration
       twi_error = TW_MT_ARB_LOST;
-      twi_releaseBus();
+      twi_finish();
       break;
 
     // Master Receiver
     case TW_MR_DATA_ACK: // data received, ack sent
       // put byte into buffer
-      twi_masterBuffer[twi_masterBufferIndex++] = TWDR;
+      twi_masterData[twi_masterBufferIndex++] = TWDR;
+      twi_stat.bytes++;
       __attribute__ ((fallthrough));
     case TW_MR_SLA_ACK:  // address sent, ack received
       // ack if more bytes are expected, otherwise nack
@@ -560,20 +852,13 @@ ISR(TWI_vect)
       break;
     case TW_MR_DATA_NACK: // data received, nack sent
       // put final byte into buffer
-      twi_masterBuffer[twi_masterBufferIndex++] = TWDR;
-      if (twi_sendStop){
-        twi_stop();
-      } else {
-        twi_inRepStart = true;	// we're gonna send the START
-        // don't enable the interrupt. We'll generate the start, but we
-        // avoid handling the interrupt until we're in the next transaction,
-        // at the point where we would normally issue the start.
-        TWCR = _BV(TWINT) | _BV(TWSTA)| _BV(TWEN) ;
-        twi_state = TWI_READY;
-      }
+      twi_masterData[twi_masterBufferIndex++] = TWDR;
+      twi_stat.bytes++;
+      twi_finish();
       break;
     case TW_MR_SLA_NACK: // address sent, nack received
-      twi_stop();
+      twi_error = TW_MR_SLA_NACK;
+      twi_finish();
       break;
     // TW_MR_ARB_LOST handled by TW_MT_ARB_LOST case
 
@@ -611,6 +896,10 @@ ISR(TWI_vect)
       twi_onSlaveReceive(twi_rxBuffer, twi_rxBufferIndex);
       // since we submit rx buffer to "wire" library, we can reset it
       twi_rxBufferIndex = 0;
+      // start a master transaction queued meanwhile
+      if(twi_queueHead){
+        twi_start();
+      }
       break;
     case TW_SR_DATA_NACK:       // data received, returned nack
     case TW_SR_GCALL_DATA_NACK: // data received generally, returned nack
@@ -653,6 +942,10 @@ ISR(TWI_vect)
       twi_reply(1);
       // leave slave receiver state
       twi_state = TWI_READY;
+      // start a master transaction queued meanwhile
+      if(twi_queueHead){
+        twi_start();
+      }
       break;
 
     // All
@@ -660,7 +953,14 @@ ISR(TWI_vect)
       break;
     case TW_BUS_ERROR: // bus error, illegal stop/start
       twi_error = TW_BUS_ERROR;
-      twi_stop();
+      if(twi_state == TWI_MTX || twi_state == TWI_MRX){
+        twi_finish();
+      }else{
+        twi_stop();
+        if(twi_queueHead){
+          twi_start();
+        }
+      }
       break;
   }
 }
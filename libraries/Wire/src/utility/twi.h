@@ -23,6 +23,8 @@
 #define twi_h
 
   #include <inttypes.h>
+  #include <stddef.h>
+  #include "twi_types.h"
 
   //#define ATMEGA8
 
@@ -30,20 +32,41 @@
   #define TWI_FREQ 100000L
   #endif
 
+  // Size of the slave receive and transmit buffers, and of the buffer for
+  // twi_writeTo() without waiting. Can be raised for the whole build, e.g.
+  // with -DTWI_BUFFER_LENGTH=128 in build.extra_flags, which also sets the
+  // Wire buffers.
   #ifndef TWI_BUFFER_LENGTH
   #define TWI_BUFFER_LENGTH 32
   #endif
+  #if TWI_BUFFER_LENGTH > 255
+  #error "TWI_BUFFER_LENGTH must be at most 255"
+  #endif
 
   #define TWI_READY 0
   #define TWI_MRX   1
   #define TWI_MTX   2
   #define TWI_SRX   3
   #define TWI_STX   4
-  
+
+  // twi_transaction.flags
+  #define TWI_NO_STOP 0x01  // keep the bus with a repeated start afterwards
+  #define TWI_REGISTER 0x02 // write reg before txData
+
+  // twi_transaction.status while queued or running; afterwards it holds
+  // the result, coded as for twi_writeTo()
+  #define TWI_PENDING 0xFF
+
+  #ifdef __cplusplus
+  extern "C" {
+  #endif
+
   void twi_init(void);
   void twi_disable(void);
   void twi_setAddress(uint8_t);
   void twi_setFrequency(uint32_t);
+  uint32_t twi_getFrequency(void);
+  void twi_setRiseTime(uint16_t);
   uint8_t twi_readFrom(uint8_t, uint8_t*, uint8_t, uint8_t);
   uint8_t twi_writeTo(uint8_t, uint8_t*, uint8_t, uint8_t, uint8_t);
   uint8_t twi_transmit(const uint8_t*, uint8_t);
@@ -55,5 +78,13 @@
   void twi_setTimeoutInMicros(uint32_t, bool);
   void twi_handleTimeout(bool);
   bool twi_manageTimeoutFlag(bool);
+  void twi_queue(twi_transaction*);
+  uint8_t twi_wait(twi_transaction*);
+  bool twi_recoverBus(void);
+  void twi_getStats(twi_stats*, bool);
+
+  #ifdef __cplusplus
+  }
+  #endif
 
 #endif
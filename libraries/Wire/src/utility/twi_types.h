@@ -0,0 +1,66 @@
+/*
+  twi_types.h - TWI/I2C library for Wiring & Arduino
+  Copyright (c) 2006 Nicholas Zambetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+// The structures that Wire.h hands to sketches as WireTransaction and
+// WireStats, apart from the rest of twi.h, which stays private to Wire.
+
+#ifndef twi_types_h
+#define twi_types_h
+
+  #include <inttypes.h>
+  #include <stddef.h>
+
+  // A master transaction: txLength bytes of txData are written to the
+  // device, preceded by reg if flags has TWI_REGISTER, then rxLength
+  // bytes are read into rxData after a repeated start. Either part may
+  // be empty; with both empty only the address is sent. The caller owns
+  // the structure and both buffers, which must stay untouched until
+  // status is no longer TWI_PENDING. callback, if set, is called from the
+  // TWI interrupt when the transaction is done and may queue further
+  // transactions.
+  typedef struct twi_transaction {
+    struct twi_transaction *next;
+    void (*callback)(struct twi_transaction *);
+    const uint8_t *txData;
+    uint8_t *rxData;
+    size_t txLength;
+    size_t rxLength;
+    size_t rxCount;           // bytes actually read
+    uint8_t address;
+    uint8_t reg;              // register address, with TWI_REGISTER
+    uint8_t flags;
+    volatile uint8_t status;
+  } twi_transaction;
+
+  // Counters kept since startup or since last cleared. transactions and
+  // the rest count master transactions only, bytes the data bytes sent or
+  // received in them (not the register address); waitMicros is the time
+  // spent blocked in twi_wait().
+  typedef struct twi_stats {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t waitMicros;
+    uint16_t nacks;           // address or data not acknowledged
+    uint16_t arbitrationLost;
+    uint16_t busErrors;
+    uint16_t timeouts;
+    uint16_t recoveries;      // twi_recoverBus() calls
+  } twi_stats;
+
+#endif